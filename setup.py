@@ -55,6 +55,8 @@ types = [
     "com.sun.star.lang.XTypeProvider", 
     "com.sun.star.beans.XPropertySet", 
     "com.sun.star.beans.XMaterialHolder", 
+    "com.sun.star.beans.PropertyValue", 
+    "com.sun.star.beans.NamedValue", 
     "com.sun.star.beans.MethodConcept", 
     "com.sun.star.reflection.XIdlReflection", 
     "com.sun.star.reflection.XIdlClass", 
@@ -63,6 +65,7 @@ types = [
     "com.sun.star.reflection.XConstantsTypeDescription", 
     "com.sun.star.reflection.XModuleTypeDescription", 
     "com.sun.star.reflection.XStructTypeDescription", 
+    "com.sun.star.reflection.XTypeDescriptionEnumerationAccess", 
     "com.sun.star.registry.InvalidRegistryException", 
     "com.sun.star.beans.XIntrospection", 
     "com.sun.star.script.XTypeConverter", 
@@ -108,12 +111,16 @@ source_dir = "./source/module"
 files = (
     "pyuno.cxx", 
     "pyuno_adapter.cxx", 
+    "pyuno_binary.cxx", 
     "pyuno_callable.cxx", 
     "pyuno_except.cxx", 
     "pyuno_gc.cxx", 
     "pyuno_module.cxx", 
     "pyuno_runtime.cxx", 
+    "pyuno_sequence.cxx", 
+    "pyuno_struct.cxx", 
     "pyuno_type.cxx", 
+    "pyuno_typeindex.cxx", 
     "pyuno_util.cxx", 
 )
 cpp_files = [source_dir + "/" + i for i in files]
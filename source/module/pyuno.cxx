@@ -23,18 +23,22 @@
 
 #include "pyuno_impl.hxx"
 
+#include <new>
+
 #include <rtl/strbuf.hxx>
 #include <rtl/ustrbuf.hxx>
 
 #include <osl/thread.h>
+#include <rtl/process.h>
+
+#include <uno/environment.hxx>
+#include <uno/lbnames.h>
 
 #include <com/sun/star/lang/XServiceInfo.hpp>
 #include <com/sun/star/lang/XTypeProvider.hpp>
 #include <com/sun/star/beans/XPropertySet.hpp>
 #include <com/sun/star/beans/XMaterialHolder.hpp>
 
-#define TO_ASCII(x) OUStringToOString( x , RTL_TEXTENCODING_ASCII_US).getStr()
-
 using rtl::OStringBuffer;
 using rtl::OUStringBuffer;
 using rtl::OUStringToOString;
@@ -62,251 +66,369 @@ namespace pyuno
 
 PyObject *PyUNO_str( PyObject * self );
 
+#define PYUNO_FREELIST_SIZE 64
+
+// released instances, only accessed with the global interpreter lock held
+static PyUNO *g_freeList[PYUNO_FREELIST_SIZE];
+static int g_nFree = 0;
+
 void PyUNO_del (PyObject* self)
 {
     PyUNO* me = reinterpret_cast< PyUNO* > (self);
+    if( me->weakreflist )
+        PyObject_ClearWeakRefs( self );
+    if( me->members.runtime.is() )
     {
+        // a newer wrapper of another interface type may have replaced the entry
+        WrapperMap & wrappers =
+            reinterpret_cast< RuntimeImpl * >( me->members.runtime.get() )->cargo->wrappers;
+        WrapperMap::iterator ii = wrappers.find( me->members.xNormalized.get() );
+        if( ii != wrappers.end() && ii->second == self )
+            wrappers.erase( ii );
+        me->members.runtime.clear();
+    }
+    {
+        // a local object may lock the SolarMutex in its release, which a
+        // thread waiting for the global interpreter lock may hold
         PyThreadDetach antiguard;
-        delete me->members;
+        me->members.~PyUNOInternals();
     }
-    PyObject_Del (self);
+    if( g_nFree < PYUNO_FREELIST_SIZE )
+        g_freeList[g_nFree++] = me;
+    else
+        PyObject_Del (self);
+}
+
+/** @return the suffix of the object identifiers of objects in this process */
+static OUString getLocalOidSuffix()
+{
+    sal_uInt8 id[16];
+    rtl_getGlobalProcessId( id );
+    OUStringBuffer buf( 32 );
+    buf.append( (sal_Unicode) ']' );
+    buf.append( (sal_Unicode) ';' );
+    for( int i = 0 ; i < 16 ; i ++ )
+        buf.append( (sal_Int32) id[i], 16 );
+    return buf.makeStringAndClear();
+}
+
+/** @return whether the object is a proxy of an object in another process.
+    Its object identifier was assigned by the other process then.
+*/
+static bool isRemote( const Reference< XInterface > & xObject )
+{
+    static com::sun::star::uno::Environment cppEnv(
+        OUString( RTL_CONSTASCII_USTRINGPARAM( CPPU_CURRENT_LANGUAGE_BINDING_NAME ) ) );
+    static const OUString localSuffix( getLocalOidSuffix() );
+    if( ! cppEnv.is() || ! cppEnv.get()->pExtEnv )
+        return true;
+    uno_ExtEnvironment *pExtEnv = cppEnv.get()->pExtEnv;
+    rtl_uString *pOid = 0;
+    (*pExtEnv->getObjectIdentifier)( pExtEnv, &pOid, xObject.get() );
+    if( ! pOid )
+        return true;
+    OUString oid( pOid, SAL_NO_ACQUIRE );
+    return oid.getLength() < localSuffix.getLength() ||
+        ! oid.match( localSuffix, oid.getLength() - localSuffix.getLength() );
 }
 
 
 
-OUString val2str( const void * pVal, typelib_TypeDescriptionReference * pTypeRef , sal_Int32 mode ) SAL_THROW( () )
+namespace {
+
+/** Renders UNO values into a buffer of bounded length. Values nested deeper
+    than the depth limit, sequence elements beyond the element limit and the
+    output beyond the length limit are elided with "...".
+*/
+class ValueFormatter
 {
-	OSL_ASSERT( pVal );
-	if (pTypeRef->eTypeClass == typelib_TypeClass_VOID)
-		return OUString( RTL_CONSTASCII_USTRINGPARAM("void") );
-	
-	OUStringBuffer buf( 64 );
-	buf.append( (sal_Unicode)'(' );
-	buf.append( pTypeRef->pTypeName );
-	buf.append( (sal_Unicode)')' );
-	
-	switch (pTypeRef->eTypeClass)
-	{
-	case typelib_TypeClass_INTERFACE:
-    {
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
-		buf.append( reinterpret_cast< sal_IntPtr >(*(void **)pVal), 16 );
-        if( VAL2STR_MODE_DEEP == mode )
+public:
+    ValueFormatter( sal_Int32 mode, sal_Int32 nMaxDepth, sal_Int32 nMaxElements, sal_Int32 nMaxLength )
+        : m_buf( 64 ), m_mode( mode ), m_nMaxDepth( nMaxDepth ),
+          m_nMaxElements( nMaxElements ), m_nMaxLength( nMaxLength )
+    {}
+
+    /** appends the value, pTypeDescr is the description of pTypeRef if
+        the caller holds it already, 0 otherwise
+    */
+    void append( const void *pVal, typelib_TypeDescriptionReference *pTypeRef,
+                 typelib_TypeDescription *pTypeDescr, sal_Int32 nDepth );
+
+    OUString makeString()
+    {
+        if( isFull() )
         {
-            buf.appendAscii( "{" );        Reference< XInterface > r = *( Reference< XInterface > * ) pVal;
-            Reference< XServiceInfo > serviceInfo( r, UNO_QUERY);
-            Reference< XTypeProvider > typeProvider(r,UNO_QUERY);
-            if( serviceInfo.is() )
-            {
-                buf.appendAscii("implementationName=" );
-                buf.append(serviceInfo->getImplementationName() );
-                buf.appendAscii(", supportedServices={" );
-                Sequence< OUString > seq = serviceInfo->getSupportedServiceNames();
-                for( int i = 0 ; i < seq.getLength() ; i ++ )
-                {
-                    buf.append( seq[i] );
-                    if( i +1 != seq.getLength() )
-                        buf.appendAscii( "," );
-                }
-                buf.appendAscii("}");
-            }
+            m_buf.setLength( m_nMaxLength );
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("...") );
+        }
+        return m_buf.makeStringAndClear();
+    }
 
-            if( typeProvider.is() )
-            {
-                buf.appendAscii(", supportedInterfaces={" );
-                Sequence< Type > seq (typeProvider->getTypes());
-                for( int i = 0 ; i < seq.getLength() ; i ++ )
-                {
-                    buf.append(seq[i].getTypeName());
-                    if( i +1 != seq.getLength() )
-                        buf.appendAscii( "," );
-                }
-                buf.appendAscii("}");
-            }
-            buf.appendAscii( "}" );
+private:
+    bool isFull() const
+    {
+        return m_buf.getLength() >= m_nMaxLength;
+    }
+
+    void appendInterface( void *pInterface, sal_Int32 nDepth );
+    void appendCompound( const void *pVal, typelib_CompoundTypeDescription *pCompType, sal_Int32 nDepth );
+    void appendSequence( uno_Sequence *pSequence, typelib_TypeDescription *pElementTypeDescr, sal_Int32 nDepth );
+    void appendEnum( sal_Int32 nValue, typelib_EnumTypeDescription *pEnumType );
+
+    OUStringBuffer m_buf;
+    sal_Int32 m_mode;
+    sal_Int32 m_nMaxDepth;
+    sal_Int32 m_nMaxElements;
+    sal_Int32 m_nMaxLength;
+};
+
+void ValueFormatter::appendInterface( void *pInterface, sal_Int32 nDepth )
+{
+    m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+    m_buf.append( reinterpret_cast< sal_IntPtr >( pInterface ), 16 );
+    // only the outermost interface is asked, these may be remote calls
+    if( VAL2STR_MODE_DEEP != m_mode || nDepth > 0 || ! pInterface )
+        return;
+
+    m_buf.appendAscii( "{" );
+    Reference< XInterface > r( static_cast< XInterface * >( pInterface ) );
+    Reference< XServiceInfo > serviceInfo( r, UNO_QUERY );
+    Reference< XTypeProvider > typeProvider( r, UNO_QUERY );
+    if( serviceInfo.is() )
+    {
+        m_buf.appendAscii( "implementationName=" );
+        m_buf.append( serviceInfo->getImplementationName() );
+        m_buf.appendAscii( ", supportedServices={" );
+        Sequence< OUString > seq = serviceInfo->getSupportedServiceNames();
+        for( int i = 0 ; i < seq.getLength() && ! isFull() ; i ++ )
+        {
+            m_buf.append( seq[i] );
+            if( i +1 != seq.getLength() )
+                m_buf.appendAscii( "," );
         }
+        m_buf.appendAscii( "}" );
+    }
+    if( typeProvider.is() )
+    {
+        m_buf.appendAscii( ", supportedInterfaces={" );
+        Sequence< Type > seq( typeProvider->getTypes() );
+        for( int i = 0 ; i < seq.getLength() && ! isFull() ; i ++ )
+        {
+            m_buf.append( seq[i].getTypeName() );
+            if( i +1 != seq.getLength() )
+                m_buf.appendAscii( "," );
+        }
+        m_buf.appendAscii( "}" );
+    }
+    m_buf.appendAscii( "}" );
+}
+
+void ValueFormatter::appendCompound(
+    const void *pVal, typelib_CompoundTypeDescription *pCompType, sal_Int32 nDepth )
+{
+    m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
+    sal_Int32 nDescr = pCompType->nMembers;
+    if( pCompType->pBaseTypeDescription )
+    {
+        // the base type is part of the same value, no further level
+        typelib_TypeDescription *pBase = &pCompType->pBaseTypeDescription->aBase;
+        append( pVal, pBase->pWeakRef, pBase, nDepth );
+        if( nDescr )
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(", ") );
+    }
+    for( sal_Int32 nPos = 0; nPos < nDescr && ! isFull(); ++nPos )
+    {
+        m_buf.append( pCompType->ppMemberNames[nPos] );
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" = ") );
+        append( (char *)pVal + pCompType->pMemberOffsets[nPos], pCompType->ppTypeRefs[nPos], 0, nDepth + 1 );
+        if( nPos < nDescr - 1 )
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(", ") );
+    }
+    m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
+}
 
-		break;
-    }
-	case typelib_TypeClass_UNION:
-	{
-//  		typelib_TypeDescription * pTypeDescr = 0;
-//  		TYPELIB_DANGER_GET( &pTypeDescr, pTypeRef );
-//  		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
-//  		buf.append( val2str( (char *)pVal + ((typelib_UnionTypeDescription *)pTypeDescr)->nValueOffset,
-//  							 union_getSetType( pVal, pTypeDescr ) ) );
-//  		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
-//  		TYPELIB_DANGER_RELEASE( pTypeDescr );
-		break;
-	}
-	case typelib_TypeClass_STRUCT:
-	case typelib_TypeClass_EXCEPTION:
-	{
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
-		typelib_TypeDescription * pTypeDescr = 0;
-		TYPELIB_DANGER_GET( &pTypeDescr, pTypeRef );
-		OSL_ASSERT( pTypeDescr );
-		
-		typelib_CompoundTypeDescription * pCompType = (typelib_CompoundTypeDescription *)pTypeDescr;
-		sal_Int32 nDescr = pCompType->nMembers;
-		
-		if (pCompType->pBaseTypeDescription)
-		{
-			buf.append( val2str( pVal, ((typelib_TypeDescription *)pCompType->pBaseTypeDescription)->pWeakRef,mode ) );
-			if (nDescr)
-				buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(", ") );
-		}
-		
-		typelib_TypeDescriptionReference ** ppTypeRefs = pCompType->ppTypeRefs;
-		sal_Int32 * pMemberOffsets = pCompType->pMemberOffsets;
-		rtl_uString ** ppMemberNames = pCompType->ppMemberNames;
-		
-		for ( sal_Int32 nPos = 0; nPos < nDescr; ++nPos )
-		{
-			buf.append( ppMemberNames[nPos] );
-			buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" = ") );
-			typelib_TypeDescription * pMemberType = 0;
-			TYPELIB_DANGER_GET( &pMemberType, ppTypeRefs[nPos] );
-			buf.append( val2str( (char *)pVal + pMemberOffsets[nPos], pMemberType->pWeakRef, mode ) );
-			TYPELIB_DANGER_RELEASE( pMemberType );
-			if (nPos < (nDescr -1))
-				buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(", ") );
-		}
-		
-		TYPELIB_DANGER_RELEASE( pTypeDescr );
-		
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
-		break;
-	}
-	case typelib_TypeClass_SEQUENCE:
-	{
-		typelib_TypeDescription * pTypeDescr = 0;
-		TYPELIB_DANGER_GET( &pTypeDescr, pTypeRef );
-		
-		uno_Sequence * pSequence = *(uno_Sequence **)pVal;
-		typelib_TypeDescription * pElementTypeDescr = 0;
-		TYPELIB_DANGER_GET( &pElementTypeDescr, ((typelib_IndirectTypeDescription *)pTypeDescr)->pType );
-		
-		sal_Int32 nElementSize = pElementTypeDescr->nSize;
-		sal_Int32 nElements	   = pSequence->nElements;
-		
-		if (nElements)
-		{
-			buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
-			char * pElements = pSequence->elements;
-			for ( sal_Int32 nPos = 0; nPos < nElements; ++nPos )
-			{
-				buf.append( val2str( pElements + (nElementSize * nPos), pElementTypeDescr->pWeakRef, mode ) );
-				if (nPos < (nElements -1))
-					buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(", ") );
-			}
-			buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
-		}
-		else
-		{
-			buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{}") );
-		}
-		TYPELIB_DANGER_RELEASE( pElementTypeDescr );
-		TYPELIB_DANGER_RELEASE( pTypeDescr );
-		break;
-	}
-	case typelib_TypeClass_ANY:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
-		buf.append( val2str( ((uno_Any *)pVal)->pData,
-							 ((uno_Any *)pVal)->pType ,
-                             mode) );
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
-		break;
-	case typelib_TypeClass_TYPE:
-		buf.append( (*(typelib_TypeDescriptionReference **)pVal)->pTypeName );
-		break;
-	case typelib_TypeClass_STRING:
-		buf.append( (sal_Unicode)'\"' );
-		buf.append( *(rtl_uString **)pVal );
-		buf.append( (sal_Unicode)'\"' );
-		break;
-	case typelib_TypeClass_ENUM:
-	{
-		typelib_TypeDescription * pTypeDescr = 0;
-		TYPELIB_DANGER_GET( &pTypeDescr, pTypeRef );
-		
-		sal_Int32 * pValues = ((typelib_EnumTypeDescription *)pTypeDescr)->pEnumValues;
-		sal_Int32 nPos = ((typelib_EnumTypeDescription *)pTypeDescr)->nEnumValues;
-		while (nPos--)
-		{
-			if (pValues[nPos] == *(int *)pVal)
-				break;
-		}
-		if (nPos >= 0)
-			buf.append( ((typelib_EnumTypeDescription *)pTypeDescr)->ppEnumNames[nPos] );
-		else
-			buf.append( (sal_Unicode)'?' );
-		
-		TYPELIB_DANGER_RELEASE( pTypeDescr );
-		break;
-	}
-	case typelib_TypeClass_BOOLEAN:
-		if (*(sal_Bool *)pVal)
-			buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("true") );
-		else
-			buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("false") );
-		break;
-	case typelib_TypeClass_CHAR:
-		buf.append( (sal_Unicode)'\'' );
-		buf.append( *(sal_Unicode *)pVal );
-		buf.append( (sal_Unicode)'\'' );
-		break;
-	case typelib_TypeClass_FLOAT:
-		buf.append( *(float *)pVal );
-		break;
-	case typelib_TypeClass_DOUBLE:
-		buf.append( *(double *)pVal );
-		break;
-	case typelib_TypeClass_BYTE:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
-		buf.append( (sal_Int32)*(sal_Int8 *)pVal, 16 );
-		break;
-	case typelib_TypeClass_SHORT:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
-		buf.append( (sal_Int32)*(sal_Int16 *)pVal, 16 );
-		break;
-	case typelib_TypeClass_UNSIGNED_SHORT:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
-		buf.append( (sal_Int32)*(sal_uInt16 *)pVal, 16 );
-		break;
-	case typelib_TypeClass_LONG:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
-		buf.append( *(sal_Int32 *)pVal, 16 );
-		break;
-	case typelib_TypeClass_UNSIGNED_LONG:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
-		buf.append( (sal_Int64)*(sal_uInt32 *)pVal, 16 );
-		break;
-	case typelib_TypeClass_HYPER:
-	case typelib_TypeClass_UNSIGNED_HYPER:
-		buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+void ValueFormatter::appendSequence(
+    uno_Sequence *pSequence, typelib_TypeDescription *pElementTypeDescr, sal_Int32 nDepth )
+{
+    sal_Int32 nElements = pSequence->nElements;
+    if( ! nElements )
+    {
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{}") );
+        return;
+    }
+    m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
+    // the element description is shared by all elements
+    sal_Int32 nElementSize = pElementTypeDescr->nSize;
+    char *pElements = pSequence->elements;
+    sal_Int32 nPos = 0;
+    for( ; nPos < nElements && nPos < m_nMaxElements && ! isFull(); ++nPos )
+    {
+        append( pElements + nElementSize * nPos, pElementTypeDescr->pWeakRef, pElementTypeDescr, nDepth + 1 );
+        if( nPos < nElements - 1 )
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(", ") );
+    }
+    if( nPos < nElements )
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("...") );
+    m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
+}
+
+void ValueFormatter::appendEnum( sal_Int32 nValue, typelib_EnumTypeDescription *pEnumType )
+{
+    sal_Int32 nPos = pEnumType->nEnumValues;
+    while( nPos-- )
+    {
+        if( pEnumType->pEnumValues[nPos] == nValue )
+            break;
+    }
+    if( nPos >= 0 )
+        m_buf.append( pEnumType->ppEnumNames[nPos] );
+    else
+        m_buf.append( (sal_Unicode)'?' );
+}
+
+void ValueFormatter::append(
+    const void *pVal, typelib_TypeDescriptionReference *pTypeRef,
+    typelib_TypeDescription *pTypeDescr, sal_Int32 nDepth )
+{
+    OSL_ASSERT( pVal );
+    if( isFull() )
+        return;
+    if( pTypeRef->eTypeClass == typelib_TypeClass_VOID )
+    {
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("void") );
+        return;
+    }
+
+    m_buf.append( (sal_Unicode)'(' );
+    m_buf.append( pTypeRef->pTypeName );
+    m_buf.append( (sal_Unicode)')' );
+
+    switch( pTypeRef->eTypeClass )
+    {
+    case typelib_TypeClass_INTERFACE:
+        appendInterface( *(void **)pVal, nDepth );
+        break;
+    case typelib_TypeClass_STRUCT:
+    case typelib_TypeClass_EXCEPTION:
+    case typelib_TypeClass_SEQUENCE:
+    case typelib_TypeClass_ENUM:
+    {
+        if( nDepth > m_nMaxDepth && pTypeRef->eTypeClass != typelib_TypeClass_ENUM )
+        {
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{...}") );
+            break;
+        }
+        typelib_TypeDescription *pDescr = pTypeDescr;
+        if( ! pDescr )
+            TYPELIB_DANGER_GET( &pDescr, pTypeRef );
+        OSL_ASSERT( pDescr );
+        if( pTypeRef->eTypeClass == typelib_TypeClass_SEQUENCE )
+        {
+            typelib_TypeDescription *pElementTypeDescr = 0;
+            TYPELIB_DANGER_GET( &pElementTypeDescr, ((typelib_IndirectTypeDescription *)pDescr)->pType );
+            appendSequence( *(uno_Sequence **)pVal, pElementTypeDescr, nDepth );
+            TYPELIB_DANGER_RELEASE( pElementTypeDescr );
+        }
+        else if( pTypeRef->eTypeClass == typelib_TypeClass_ENUM )
+            appendEnum( *(sal_Int32 *)pVal, (typelib_EnumTypeDescription *)pDescr );
+        else
+            appendCompound( pVal, (typelib_CompoundTypeDescription *)pDescr, nDepth );
+        if( ! pTypeDescr )
+            TYPELIB_DANGER_RELEASE( pDescr );
+        break;
+    }
+    case typelib_TypeClass_ANY:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("{ ") );
+        append( ((uno_Any *)pVal)->pData, ((uno_Any *)pVal)->pType, 0, nDepth + 1 );
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(" }") );
+        break;
+    case typelib_TypeClass_TYPE:
+        m_buf.append( (*(typelib_TypeDescriptionReference **)pVal)->pTypeName );
+        break;
+    case typelib_TypeClass_STRING:
+    {
+        // long strings are cut at the length limit without being copied
+        rtl_uString *pStr = *(rtl_uString **)pVal;
+        m_buf.append( (sal_Unicode)'\"' );
+        sal_Int32 nLength = pStr->length;
+        if( nLength > m_nMaxLength - m_buf.getLength() )
+            nLength = m_nMaxLength > m_buf.getLength() ? m_nMaxLength - m_buf.getLength() : 0;
+        m_buf.append( pStr->buffer, nLength );
+        m_buf.append( (sal_Unicode)'\"' );
+        break;
+    }
+    case typelib_TypeClass_BOOLEAN:
+        if (*(sal_Bool *)pVal)
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("true") );
+        else
+            m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("false") );
+        break;
+    case typelib_TypeClass_CHAR:
+        m_buf.append( (sal_Unicode)'\'' );
+        m_buf.append( *(sal_Unicode *)pVal );
+        m_buf.append( (sal_Unicode)'\'' );
+        break;
+    case typelib_TypeClass_FLOAT:
+        m_buf.append( *(float *)pVal );
+        break;
+    case typelib_TypeClass_DOUBLE:
+        m_buf.append( *(double *)pVal );
+        break;
+    case typelib_TypeClass_BYTE:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+        m_buf.append( (sal_Int32)*(sal_Int8 *)pVal, 16 );
+        break;
+    case typelib_TypeClass_SHORT:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+        m_buf.append( (sal_Int32)*(sal_Int16 *)pVal, 16 );
+        break;
+    case typelib_TypeClass_UNSIGNED_SHORT:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+        m_buf.append( (sal_Int32)*(sal_uInt16 *)pVal, 16 );
+        break;
+    case typelib_TypeClass_LONG:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+        m_buf.append( *(sal_Int32 *)pVal, 16 );
+        break;
+    case typelib_TypeClass_UNSIGNED_LONG:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
+        m_buf.append( (sal_Int64)*(sal_uInt32 *)pVal, 16 );
+        break;
+    case typelib_TypeClass_HYPER:
+    case typelib_TypeClass_UNSIGNED_HYPER:
+        m_buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("0x") );
 #if defined(GCC) && defined(SPARC)
-		{
-			sal_Int64 aVal;
-			*(sal_Int32 *)&aVal = *(sal_Int32 *)pVal;
-			*((sal_Int32 *)&aVal +1)= *((sal_Int32 *)pVal +1);
-			buf.append( aVal, 16 );
-		}
+        {
+            sal_Int64 aVal;
+            *(sal_Int32 *)&aVal = *(sal_Int32 *)pVal;
+            *((sal_Int32 *)&aVal +1)= *((sal_Int32 *)pVal +1);
+            m_buf.append( aVal, 16 );
+        }
 #else
-		buf.append( *(sal_Int64 *)pVal, 16 );
+        m_buf.append( *(sal_Int64 *)pVal, 16 );
 #endif
-		break;
-		
-	case typelib_TypeClass_VOID:
-	case typelib_TypeClass_ARRAY:
-	case typelib_TypeClass_UNKNOWN:
-	case typelib_TypeClass_SERVICE:
-	case typelib_TypeClass_MODULE:
-	default:
-		buf.append( (sal_Unicode)'?' );
-	}
-	
-	return buf.makeStringAndClear();
+        break;
+
+    case typelib_TypeClass_UNION:
+        break;
+    case typelib_TypeClass_VOID:
+    case typelib_TypeClass_ARRAY:
+    case typelib_TypeClass_UNKNOWN:
+    case typelib_TypeClass_SERVICE:
+    case typelib_TypeClass_MODULE:
+    default:
+        m_buf.append( (sal_Unicode)'?' );
+    }
+}
+
+}
+
+OUString val2str( const void * pVal, typelib_TypeDescriptionReference * pTypeRef , sal_Int32 mode,
+                  sal_Int32 nMaxDepth, sal_Int32 nMaxElements, sal_Int32 nMaxLength ) SAL_THROW( () )
+{
+    ValueFormatter formatter( mode, nMaxDepth, nMaxElements, nMaxLength );
+    formatter.append( pVal, pTypeRef, 0, 0 );
+    return formatter.makeString();
 }
 
 
@@ -315,10 +437,10 @@ PyObject *PyUNO_repr( PyObject  * self )
     PyUNO *me = (PyUNO * ) self;
     PyObject * ret = 0;
     
-    if( me->members->wrappedObject.getValueType().getTypeClass()
+    if( me->members.wrappedObject.getValueType().getTypeClass()
         == com::sun::star::uno::TypeClass_EXCEPTION )
     {
-        Reference< XMaterialHolder > rHolder(me->members->xInvocation,UNO_QUERY);
+        Reference< XMaterialHolder > rHolder(me->members.xInvocation,UNO_QUERY);
         if( rHolder.is() )
         {
             Any a = rHolder->getMaterial();
@@ -345,8 +467,8 @@ PyObject *PyUNO_invoke( PyObject *object, const char *name , PyObject *args )
         if( PyObject_IsInstance( object, getPyUnoClass().get() ) )
         {
             PyUNO* me = (PyUNO*) object;
-            OUString attrName = OUString::createFromAscii(name);
-            if (! me->members->xInvocation->hasMethod (attrName))
+            OUString attrName = getScratchString( name );
+            if (! me->members.xInvocation->hasMethod (attrName))
             {
                 OUStringBuffer buf;
                 buf.appendAscii( "Attribute " );
@@ -355,7 +477,7 @@ PyObject *PyUNO_invoke( PyObject *object, const char *name , PyObject *args )
                 throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () );
             }
             callable = PyUNO_callable_new (
-                me->members->xInvocation,
+                me->members.xInvocation,
                 attrName,
                 ACCEPT_UNO_ANY);
             paras = args;
@@ -414,12 +536,12 @@ PyObject *PyUNO_str( PyObject * self )
     OStringBuffer buf;
 
     
-    if( me->members->wrappedObject.getValueType().getTypeClass()
+    if( me->members.wrappedObject.getValueType().getTypeClass()
         == com::sun::star::uno::TypeClass_STRUCT ||
-        me->members->wrappedObject.getValueType().getTypeClass()
+        me->members.wrappedObject.getValueType().getTypeClass()
         == com::sun::star::uno::TypeClass_EXCEPTION)
     {
-        Reference< XMaterialHolder > rHolder(me->members->xInvocation,UNO_QUERY);
+        Reference< XMaterialHolder > rHolder(me->members.xInvocation,UNO_QUERY);
         if( rHolder.is() )
         {
             PyThreadDetach antiguard;
@@ -430,12 +552,14 @@ PyObject *PyUNO_str( PyObject * self )
     }
     else
     {
-        // a common UNO object
+        // a common UNO object, proxies of remote objects are not asked for
+        // their services and types
         PyThreadDetach antiguard;
         buf.append( "pyuno object " );
         
-        OUString s = val2str( (void*)me->members->wrappedObject.getValue(),
-                              me->members->wrappedObject.getValueType().getTypeLibType() );
+        OUString s = val2str( (void*)me->members.wrappedObject.getValue(),
+                              me->members.wrappedObject.getValueType().getTypeLibType(),
+                              isRemote( me->members.xNormalized ) ? VAL2STR_MODE_SHALLOW : VAL2STR_MODE_DEEP );
         buf.append( OUStringToOString(s,RTL_TEXTENCODING_ASCII_US) );
     }
 #if PY_VERSION_HEX >= 0x03030000
@@ -468,7 +592,7 @@ PyObject* PyUNO_getattr (PyObject* self, char* name)
             PyObject* member_list;
             Sequence<OUString> oo_member_list;
 
-            oo_member_list = me->members->xInvocation->getMemberNames ();
+            oo_member_list = me->members.xInvocation->getMemberNames ();
             member_list = PyList_New (oo_member_list.getLength ());
             for (int i = 0; i < oo_member_list.getLength (); i++)
             {
@@ -493,25 +617,25 @@ PyObject* PyUNO_getattr (PyObject* self, char* name)
 
         if (strcmp (name, "__class__") == 0)
         {
-            if( me->members->wrappedObject.getValueTypeClass() ==
+            if( me->members.wrappedObject.getValueTypeClass() ==
                 com::sun::star::uno::TypeClass_STRUCT ||
-                me->members->wrappedObject.getValueTypeClass() ==
+                me->members.wrappedObject.getValueTypeClass() ==
                 com::sun::star::uno::TypeClass_EXCEPTION )
             {
                 return getClass(
-                    me->members->wrappedObject.getValueType().getTypeName(), runtime ).getAcquired();
+                    me->members.wrappedObject.getValueType().getTypeName(), runtime ).getAcquired();
             }
             Py_INCREF (Py_None);
             return Py_None;
         }
 
-        OUString attrName( OUString::createFromAscii( name ) );
+        OUString attrName( getScratchString( name ) );
         //We need to find out if it's a method...
-        if (me->members->xInvocation->hasMethod (attrName))
+        if (me->members.xInvocation->hasMethod (attrName))
         {
             //Create a callable object to invoke this...
             PyRef ret = PyUNO_callable_new (
-                me->members->xInvocation,
+                me->members.xInvocation,
                 attrName);
             Py_XINCREF( ret.get() );
             return ret.get();
@@ -519,13 +643,13 @@ PyObject* PyUNO_getattr (PyObject* self, char* name)
         }
 
         //or a property
-        if (me->members->xInvocation->hasProperty ( attrName))
+        if (me->members.xInvocation->hasProperty ( attrName))
         {
             //Return the value of the property
             Any anyRet;
             {
                 PyThreadDetach antiguard;
-                anyRet = me->members->xInvocation->getValue (attrName);
+                anyRet = me->members.xInvocation->getValue (attrName);
             }
             PyRef ret = runtime.any2PyObject(anyRet);
             Py_XINCREF( ret.get() );
@@ -575,12 +699,12 @@ int PyUNO_setattr (PyObject* self, char* name, PyObject* value)
         Runtime runtime;
         Any val= runtime.pyObject2Any(value, ACCEPT_UNO_ANY);
 
-        OUString attrName( OUString::createFromAscii( name ) );
+        OUString attrName( getScratchString( name ) );
         {
             PyThreadDetach antiguard;
-            if (me->members->xInvocation->hasProperty (attrName))
+            if (me->members.xInvocation->hasProperty (attrName))
             {
-                me->members->xInvocation->setValue (attrName, val);
+                me->members.xInvocation->setValue (attrName, val);
                 return 0; //Keep with Python's boolean system
             }
         }
@@ -618,7 +742,7 @@ static PyObject *PyUNO_dir( PyObject *self, PyObject *that )
     Sequence<OUString> oo_member_list;
     
     me = (PyUNO*) self;
-    oo_member_list = me->members->xInvocation->getMemberNames ();
+    oo_member_list = me->members.xInvocation->getMemberNames ();
     member_list = PyList_New (oo_member_list.getLength ());
     for (int i = 0; i < oo_member_list.getLength (); i++)
     {
@@ -649,27 +773,16 @@ static PyObject *PyUNO_richcompare( PyObject *self, PyObject *that, int op )
             {
                 PyUNO *me = reinterpret_cast< PyUNO*> ( self );
                 PyUNO *other = reinterpret_cast< PyUNO *> (that );
-                com::sun::star::uno::TypeClass tcMe = me->members->wrappedObject.getValueTypeClass();
-                com::sun::star::uno::TypeClass tcOther = other->members->wrappedObject.getValueTypeClass();
+                com::sun::star::uno::TypeClass tcMe = me->members.wrappedObject.getValueTypeClass();
+                com::sun::star::uno::TypeClass tcOther = other->members.wrappedObject.getValueTypeClass();
             
+                // structs are UNOStruct instances, compared by their own type
                 if( tcMe == tcOther )
                 {
-                    if( tcMe == com::sun::star::uno::TypeClass_STRUCT ||
-                        tcMe == com::sun::star::uno::TypeClass_EXCEPTION )
+                    if( tcMe == com::sun::star::uno::TypeClass_INTERFACE )
                     {
-                        Reference< XMaterialHolder > xMe( me->members->xInvocation,UNO_QUERY);
-                        Reference< XMaterialHolder > xOther( other->members->xInvocation,UNO_QUERY );
-                        if( xMe->getMaterial() == xOther->getMaterial() )
-                        {
-                            if (op == Py_EQ)
-                                Py_RETURN_TRUE;
-                            else
-                                Py_RETURN_FALSE;
-                        }
-                    }
-                    else if( tcMe == com::sun::star::uno::TypeClass_INTERFACE )
-                    {
-                        if( me->members->wrappedObject == other->members->wrappedObject )
+                        // the same object has the same normalized interface
+                        if( me->members.xNormalized == other->members.xNormalized )
                         {
                             if (op == Py_EQ)
                                 Py_RETURN_TRUE;
@@ -697,6 +810,15 @@ static PyObject *PyUNO_richcompare( PyObject *self, PyObject *that, int op )
     return NULL;
 }
 
+/** hashes like the equality of interfaces, by the normalized interface */
+static Py_hash_t PyUNO_hash( PyObject *self )
+{
+    PyUNO *me = reinterpret_cast< PyUNO * >( self );
+    sal_uIntPtr n = reinterpret_cast< sal_uIntPtr >( me->members.xNormalized.get() );
+    // the lower bits of an aligned pointer are always zero
+    Py_hash_t ret = (Py_hash_t) ( ( n >> 4 ) | ( n << ( 8 * sizeof( n ) - 4 ) ) );
+    return ret == -1 ? -2 : ret;
+}
 
 static struct PyMethodDef PyUNO_methods[] = {
     { "__dir__", (PyCFunction)PyUNO_dir, METH_VARARGS, NULL},
@@ -719,23 +841,15 @@ static int PyUNO_cmp( PyObject *self, PyObject *that )
 
             PyUNO *me = reinterpret_cast< PyUNO*> ( self );
             PyUNO *other = reinterpret_cast< PyUNO *> (that );
-            com::sun::star::uno::TypeClass tcMe = me->members->wrappedObject.getValueTypeClass();
-            com::sun::star::uno::TypeClass tcOther = other->members->wrappedObject.getValueTypeClass();
+            com::sun::star::uno::TypeClass tcMe = me->members.wrappedObject.getValueTypeClass();
+            com::sun::star::uno::TypeClass tcOther = other->members.wrappedObject.getValueTypeClass();
         
             if( tcMe == tcOther )
             {
-                if( tcMe == com::sun::star::uno::TypeClass_STRUCT ||
-                    tcMe == com::sun::star::uno::TypeClass_EXCEPTION )
+                if( tcMe == com::sun::star::uno::TypeClass_INTERFACE )
                 {
-                    Reference< XMaterialHolder > xMe( me->members->xInvocation,UNO_QUERY);
-                    Reference< XMaterialHolder > xOther( other->members->xInvocation,UNO_QUERY );
-                    if( xMe->getMaterial() == xOther->getMaterial() )
-                        return 0;
-                }
-                else if( tcMe == com::sun::star::uno::TypeClass_INTERFACE )
-                {
-                    if( me->members->wrappedObject == other->members->wrappedObject )
-//                     if( me->members->xInvocation == other->members->xInvocation )
+                    if( me->members.wrappedObject == other->members.wrappedObject )
+//                     if( me->members.xInvocation == other->members.xInvocation )
                         return 0;
                 }
             }
@@ -775,7 +889,7 @@ static PyTypeObject PyUNOType =
     0, /* tp_as_number */
     0, /* tp_as_sequence */
     0, /* tp_as_mapping */
-    (hashfunc) 0, /* tp_hash */
+    (hashfunc) PyUNO_hash, /* tp_hash */
     (ternaryfunc) 0, /* tp_call */
     (reprfunc) PyUNO_str, /* tp_str */
 #if PY_VERSION_HEX >= 0x03030000
@@ -795,7 +909,7 @@ static PyTypeObject PyUNOType =
 #else
     (richcmpfunc)0, /* tp_richcompare */
 #endif
-    0, /* tp_weaklistoffset */
+    offsetof( PyUNO, weakreflist ), /* tp_weaklistoffset */
     (getiterfunc)0, /* tp_iter */
     (iternextfunc)0, /* tp_iternext */
 #if PY_VERSION_HEX >= 0x03000000
@@ -831,8 +945,7 @@ PyRef getPyUnoClass()
     return PyRef( reinterpret_cast< PyObject * > ( &PyUNOType ) );
 }
 
-PyObject* PyUNO_new (
-    const Any & targetInterface, const Reference<XSingleServiceFactory> &ssf)
+PyObject* PyUNO_new( const Any & targetInterface, const Runtime & runtime )
 {
     Reference<XInterface> tmp_interface;
   
@@ -844,31 +957,68 @@ PyObject* PyUNO_new (
         return Py_None;
     }
 
-    return PyUNO_new_UNCHECKED (targetInterface, ssf);
-}
+    // may call into the object or its bridge
+    Reference< XInterface > xNormalized;
+    {
+        PyThreadDetach antiguard;
+        xNormalized = Reference< XInterface >( tmp_interface, UNO_QUERY );
+    }
+    if( ! xNormalized.is() )
+        xNormalized = tmp_interface;
 
+    // an object wrapped again shares the invocation, which is expensive
+    // to create, with the wrapper it already has
+    RuntimeCargo *cargo = runtime.getImpl()->cargo;
+    Reference< XInvocation2 > xInvocation;
+    WrapperMap::const_iterator ii = cargo->wrappers.find( xNormalized.get() );
+    if( ii != cargo->wrappers.end() )
+    {
+        PyUNO *existing = reinterpret_cast< PyUNO * >( ii->second );
+        if( typelib_typedescriptionreference_equals(
+                existing->members.wrappedObject.getValueTypeRef(), targetInterface.getValueTypeRef() ) )
+        {
+            Py_INCREF( ii->second );
+            return ii->second;
+        }
+        xInvocation = existing->members.xInvocation;
+    }
 
-PyObject* PyUNO_new_UNCHECKED (
-    const Any &targetInterface,
-    const Reference<XSingleServiceFactory> &ssf )
-{
     PyUNO* self;
-    Sequence<Any> arguments (1);
-    Reference<XInterface> tmp_interface;
-
-    self = PyObject_New (PyUNO, &PyUNOType);
-    if (self == NULL)
-        return NULL; //NULL == error
-    self->members = new PyUNOInternals();
+    if( g_nFree )
+    {
+        self = g_freeList[--g_nFree];
+        PyObject_Init( reinterpret_cast< PyObject * >( self ), &PyUNOType );
+    }
+    else
+    {
+        self = PyObject_New (PyUNO, &PyUNOType);
+        if (self == NULL)
+            return NULL; //NULL == error
+    }
+    new ( &self->members ) PyUNOInternals();
+    self->weakreflist = 0;
+    self->members.wrappedObject = targetInterface;
+    self->members.xNormalized = xNormalized;
 
-    arguments[0] <<= targetInterface;
+    if( ! xInvocation.is() )
     {
-        PyThreadDetach antiguard;
-        tmp_interface = ssf->createInstanceWithArguments (arguments);
-        Reference<XInvocation2> tmp_invocation (tmp_interface, UNO_QUERY);
-        self->members->xInvocation = tmp_invocation;
-        self->members->wrappedObject = targetInterface;
+        Sequence<Any> arguments (1);
+        arguments[0] <<= targetInterface;
+        try
+        {
+            PyThreadDetach antiguard;
+            xInvocation = Reference< XInvocation2 >(
+                cargo->xInvocation->createInstanceWithArguments (arguments), UNO_QUERY );
+        }
+        catch( ... )
+        {
+            Py_DECREF( self );
+            throw;
+        }
     }
+    self->members.xInvocation = xInvocation;
+    self->members.runtime = PyRef( reinterpret_cast< PyObject * >( runtime.getImpl() ) );
+    cargo->wrappers[ xNormalized.get() ] = reinterpret_cast< PyObject * >( self );
     return (PyObject*) self;
 }
 
@@ -29,6 +29,11 @@
 
 #include <cppuhelper/typeprovider.hxx>
 
+#include <rtl/instance.hxx>
+#include <osl/interlck.h>
+#include <string.h>
+#include <algorithm>
+
 using rtl::OUStringToOString;
 using rtl::OUString;
 using rtl::OUStringBuffer;
@@ -53,16 +58,297 @@ using com::sun::star::reflection::XIdlMethod;
 using com::sun::star::reflection::ParamInfo;
 using com::sun::star::reflection::XIdlClass;
 
-#define TO_ASCII(x) OUStringToOString( x , RTL_TEXTENCODING_ASCII_US).getStr()
-
 namespace pyuno
 {
 
+AdapterClass::AdapterClass( const PyRef & type )
+    : mRefCount( 1 ),
+      mInterpreter( PyThreadState_Get()->interp ),
+      mType( type )
+{}
+
+AdapterClass::~AdapterClass()
+{
+    // the last adapter may be released by any UNO thread
+    for( AdapterAttributeMap::iterator ii = mAttributes.begin();
+         ii != mAttributes.end() ; ++ii )
+    {
+        decreaseRefCount( mInterpreter, ii->second.name.get() );
+        ii->second.name.scratch();
+        if( ii->second.function.is() )
+        {
+            decreaseRefCount( mInterpreter, ii->second.function.get() );
+            ii->second.function.scratch();
+        }
+    }
+    decreaseRefCount( mInterpreter, mType.get() );
+    mType.scratch();
+}
+
+/** @return the version tag of the class or 0, if the tag is not valid.
+    Both fields are single words, which python only writes with the global
+    interpreter lock held. They are read without it by hasProperty, a
+    concurrent modification of the class is then seen like one that
+    happened after the call.
+ */
+static unsigned int readVersionTag( PyTypeObject *pType )
+{
+    // python drops Py_TPFLAGS_VALID_VERSION_TAG, whenever the class
+    // or one of its bases gets modified
+    const volatile unsigned long *pFlags = (const volatile unsigned long *) &pType->tp_flags;
+    if( ! ( *pFlags & Py_TPFLAGS_VALID_VERSION_TAG ) )
+        return 0;
+    return *(const volatile unsigned int *) &pType->tp_version_tag;
+}
+
+bool AdapterClass::isCurrent( const AdapterAttribute & attr ) const
+{
+    return attr.versionTag != 0 &&
+        readVersionTag( reinterpret_cast< PyTypeObject * >( mType.get() ) ) == attr.versionTag;
+}
+
+bool AdapterClass::isDeclared( const OUString & name )
+{
+    osl::MutexGuard guard( mMutex );
+    // the entry is not copied, that would touch the python refcounts
+    AdapterAttributeMap::const_iterator ii = mAttributes.find( name );
+    return ii != mAttributes.end() && ii->second.declared && isCurrent( ii->second );
+}
+
+AdapterAttribute AdapterClass::getAttribute( const OUString & name )
+{
+    AdapterAttribute outdated; // released after the guard, may run python code
+    osl::MutexGuard guard( mMutex );
+    AdapterAttributeMap::iterator ii = mAttributes.find( name );
+    if( ii != mAttributes.end() )
+    {
+        if( isCurrent( ii->second ) )
+            return ii->second;
+        outdated = ii->second;
+    }
+
+    PyTypeObject *pType = reinterpret_cast< PyTypeObject * >( mType.get() );
+    AdapterAttribute attr;
+    attr.name = outdated.name.is() ? outdated.name : ustring2PyInternedString( name );
+
+    // _PyType_Lookup() assigns a new version tag to the class when needed
+    PyObject *found = _PyType_Lookup( pType, attr.name.get() );
+    if( found && pType->tp_getattro == PyObject_GenericGetAttr )
+    {
+        if( PyFunction_Check( found ) )
+            attr.function = found;
+        attr.declared = PyFunction_Check( found ) || ! Py_TYPE( found )->tp_descr_get;
+    }
+    if( PyType_HasFeature( pType, Py_TPFLAGS_VALID_VERSION_TAG ) )
+        attr.versionTag = pType->tp_version_tag;
+    attr.typeProviderMethod =
+        name.equalsAsciiL( RTL_CONSTASCII_STRINGPARAM( "getTypes" ) ) ||
+        name.equalsAsciiL( RTL_CONSTASCII_STRINGPARAM( "getImplementationId" ) );
+
+    mAttributes[ name ] = attr;
+    return attr;
+}
+
+/** drops the classes without adapters, dynamically created classes
+    would pile up otherwise
+ */
+static void sweepAdapterClasses( AdapterClasses & classes )
+{
+    AdapterClassMap::iterator ii = classes.map.begin();
+    while( ii != classes.map.end() )
+    {
+        AdapterClassMap::iterator next = ii;
+        ++next;
+        if( ii->second->isUnused() )
+        {
+            ii->second->release();
+            classes.map.erase( ii );
+        }
+        ii = next;
+    }
+    classes.nSweepAt = ::std::max( (size_t) 64, classes.map.size() * 2 );
+}
+
+AdapterClass *getAdapterClass( const Runtime & runtime, PyObject *type )
+{
+    AdapterClasses & classes = runtime.getImpl()->cargo->adapterClasses;
+    AdapterClassMap::const_iterator ii = classes.map.find( PyRef( type ) );
+    if( ii != classes.map.end() )
+    {
+        ii->second->acquire();
+        return ii->second;
+    }
+
+    if( classes.map.size() >= classes.nSweepAt )
+        sweepAdapterClasses( classes );
+    AdapterClass *pClass = new AdapterClass( type ); // the reference of the map
+    classes.map[ PyRef( type ) ] = pClass;
+    pClass->acquire();
+    return pClass;
+}
+
+AdapterMap::AdapterMap()
+    : mpEntries( 0 ),
+      mnCapacity( 0 ),
+      mnUsed( 0 )
+{
+    rehash( 64 );
+}
+
+AdapterMap::~AdapterMap()
+{
+    delete [] mpEntries;
+}
+
+// the entries of removed adapters keep their key with a null adapter,
+// so the probe sequences of other keys are not interrupted
+AdapterMap::Entry *AdapterMap::find( PyObject *key )
+{
+    sal_uInt32 mask = mnCapacity - 1;
+    sal_uInt32 i = ( sal::static_int_cast< sal_uInt32 >(
+                         reinterpret_cast< sal_uIntPtr >( key ) >> 4 ) * 2654435761U ) & mask;
+    Entry *pRemoved = 0;
+    while( mpEntries[i].key )
+    {
+        if( mpEntries[i].key == key && mpEntries[i].adapter )
+            return &mpEntries[i];
+        if( ! pRemoved && ! mpEntries[i].adapter )
+            pRemoved = &mpEntries[i];
+        i = ( i + 1 ) & mask;
+    }
+    return pRemoved ? pRemoved : &mpEntries[i];
+}
+
+void AdapterMap::rehash( sal_uInt32 capacity )
+{
+    Entry *pOld = mpEntries;
+    sal_uInt32 nOld = mnCapacity;
+
+    mpEntries = new Entry[ capacity ];
+    memset( mpEntries, 0, capacity * sizeof( Entry ) );
+    mnCapacity = capacity;
+    mnUsed = 0;
+    for( sal_uInt32 i = 0 ; i < nOld ; i ++ )
+    {
+        if( pOld[i].adapter )
+        {
+            *find( pOld[i].key ) = pOld[i];
+            mnUsed ++;
+        }
+    }
+    delete [] pOld;
+}
+
+Adapter *AdapterMap::lookup( PyObject *object )
+{
+    osl::MutexGuard guard( mMutex );
+    Entry *pEntry = find( object );
+    if( pEntry->key != object || ! pEntry->adapter )
+        return 0;
+    // entries are removed before the adapter's refcount can drop to zero
+    pEntry->adapter->acquire();
+    return pEntry->adapter;
+}
+
+void AdapterMap::insert( PyObject *object, Adapter *adapter )
+{
+    osl::MutexGuard guard( mMutex );
+    Entry *pEntry = find( object );
+    if( pEntry->key == object && pEntry->adapter )
+    {
+        // another thread has been faster, keep the first one
+        return;
+    }
+    if( ! pEntry->key )
+        mnUsed ++;
+    pEntry->key = object;
+    pEntry->adapter = adapter;
+
+    if( mnUsed * 3 > mnCapacity * 2 )
+    {
+        // count the live entries, removed ones are dropped by rehash()
+        sal_uInt32 nLive = 0;
+        for( sal_uInt32 i = 0 ; i < mnCapacity ; i ++ )
+            if( mpEntries[i].adapter )
+                nLive ++;
+        rehash( nLive * 3 > mnCapacity ? mnCapacity * 2 : mnCapacity );
+    }
+}
+
+void AdapterMap::remove( PyObject *object, Adapter *adapter )
+{
+    Entry *pEntry = find( object );
+    if( pEntry->key == object && pEntry->adapter == adapter )
+        pEntry->adapter = 0;
+}
+
+void AdapterMap::collect( std::vector< Adapter * > & adapters )
+{
+    osl::MutexGuard guard( mMutex );
+    for( sal_uInt32 i = 0 ; i < mnCapacity ; i ++ )
+    {
+        if( mpEntries[i].adapter )
+        {
+            mpEntries[i].adapter->acquire();
+            adapters.push_back( mpEntries[i].adapter );
+        }
+    }
+}
+
+struct theAdapterMap : public rtl::Static< AdapterMap, theAdapterMap > {};
+
+AdapterMap & getAdapterMap()
+{
+    return theAdapterMap::get();
+}
+
+static bool isShadowedByInstance( PyObject *obj, PyObject *name )
+{
+    PyObject **ppDict = _PyObject_GetDictPtr( obj );
+    return ppDict && *ppDict && PyDict_GetItem( *ppDict, name );
+}
+
 Adapter::Adapter( const PyRef & ref, const Sequence< Type > &types )
     : mWrappedObject( ref ),
       mInterpreter( (PyThreadState_Get()->interp) ),
+      mpClass( 0 ),
       mTypes( types )
-{}
+{
+    Runtime runtime;
+    mpClass = getAdapterClass(
+        runtime, reinterpret_cast< PyObject * >( Py_TYPE( ref.get() ) ) );
+}
+
+AdapterClass *Adapter::getClass()
+{
+    PyObject *type = reinterpret_cast< PyObject * >( Py_TYPE( mWrappedObject.get() ) );
+    if( type != mpClass->getType() )
+    {
+        // __class__ of the object has been reassigned
+        Runtime runtime;
+        AdapterClass *pNew = getAdapterClass( runtime, type );
+        osl::MutexGuard guard( mClassMutex );
+        mpClass->release();
+        mpClass = pNew;
+    }
+    return mpClass;
+}
+
+PyRef Adapter::lookupMethod(
+    const OUString & name, AdapterAttribute & attr, sal_Int32 & nSelf )
+{
+    attr = getClass()->getAttribute( name );
+    if( attr.function.is() &&
+        ! isShadowedByInstance( mWrappedObject.get(), attr.name.get() ) )
+    {
+        // call the function of the class directly, saves the bound method
+        nSelf = 1;
+        return attr.function;
+    }
+    nSelf = 0;
+    return PyRef(
+        PyObject_GetAttr( mWrappedObject.get(), attr.name.get() ), SAL_NO_ACQUIRE );
+}
 
 Adapter::~Adapter()
 {
@@ -70,6 +356,28 @@ Adapter::~Adapter()
     //       There is no runtime function to get to know this.
     decreaseRefCount( mInterpreter, mWrappedObject.get() );
     mWrappedObject.scratch();
+    if( mpClass )
+        mpClass->release();
+}
+
+void Adapter::release() throw ()
+{
+    {
+        // the decrement must happen with the map locked, otherwise a lookup
+        // could acquire an adapter, which is going to be destroyed
+        AdapterMap & adapters = getAdapterMap();
+        osl::MutexGuard guard( adapters.getMutex() );
+        if( osl_decrementInterlockedCount( &m_refCount ) != 0 )
+            return;
+        adapters.remove( mWrappedObject.get(), this );
+
+        // nobody can find this adapter anymore, let the base class
+        // release the last reference
+        osl_incrementInterlockedCount( &m_refCount );
+    }
+    cppu::WeakImplHelper2<
+        com::sun::star::script::XInvocation,
+        com::sun::star::lang::XUnoTunnel >::release();
 }
 
 static cppu::OImplementationId g_id( sal_False );
@@ -219,26 +527,10 @@ Any Adapter::invoke( const OUString &aFunctionName,
                      mWrappedObject.get(), aFunctionName, aParams );
         }
        
-        sal_Int32 size = aParams.getLength();
-        PyRef argsTuple(PyTuple_New( size ), SAL_NO_ACQUIRE );
-        int i;
-        // fill tuple with default values in case of exceptions
-        for(  i = 0 ;i < size ; i ++ )
-        {
-            Py_INCREF( Py_None );
-            PyTuple_SetItem( argsTuple.get(), i, Py_None );
-        }
-
-        // convert args to python
-        for( i = 0; i < size ; i ++  )
-        {
-            PyRef val = runtime.any2PyObject( aParams[i] );
-            PyTuple_SetItem( argsTuple.get(), i, val.getAcquired() );
-        }
-
-        // get callable
-        PyRef method(PyObject_GetAttrString( mWrappedObject.get(), (char*)TO_ASCII(aFunctionName)),
-                     SAL_NO_ACQUIRE);
+        // get callable, the name is resolved only once per class
+        AdapterAttribute attr;
+        sal_Int32 nSelf = 0;
+        PyRef method = lookupMethod( aFunctionName, attr, nSelf );
         raiseInvocationTargetExceptionWhenNeeded( runtime);
         if( !method.is() )
         {
@@ -254,6 +546,25 @@ Any Adapter::invoke( const OUString &aFunctionName,
             throw IllegalArgumentException( buf.makeStringAndClear(), Reference< XInterface > (),0 );
         }
 
+        sal_Int32 size = aParams.getLength();
+        PyRef argsTuple(PyTuple_New( nSelf + size ), SAL_NO_ACQUIRE );
+        int i;
+        // fill tuple with default values in case of exceptions
+        for(  i = nSelf ;i < nSelf + size ; i ++ )
+        {
+            Py_INCREF( Py_None );
+            PyTuple_SetItem( argsTuple.get(), i, Py_None );
+        }
+        if( nSelf )
+            PyTuple_SetItem( argsTuple.get(), 0, mWrappedObject.getAcquired() );
+
+        // convert args to python
+        for( i = 0; i < size ; i ++  )
+        {
+            PyRef val = runtime.any2PyObject( aParams[i] );
+            PyTuple_SetItem( argsTuple.get(), nSelf + i, val.getAcquired() );
+        }
+
         PyRef pyRet( PyObject_CallObject( method.get(), argsTuple.get() ), SAL_NO_ACQUIRE );
         raiseInvocationTargetExceptionWhenNeeded( runtime);
         if( pyRet.is() )
@@ -262,8 +573,7 @@ Any Adapter::invoke( const OUString &aFunctionName,
 
             if( ret.hasValue() &&
                 ret.getValueTypeClass() == com::sun::star::uno::TypeClass_SEQUENCE &&
-                0 != aFunctionName.compareToAscii( "getTypes" ) &&  // needed by introspection itself !
-                0 != aFunctionName.compareToAscii( "getImplementationId" ) ) // needed by introspection itself !
+                ! attr.typeProviderMethod ) // needed by introspection itself !
             {
                 // the sequence can either be
                 // 1)  a simple sequence return value
@@ -367,7 +677,9 @@ Any Adapter::invoke( const OUString &aFunctionName,
 void Adapter::setValue( const OUString & aPropertyName, const Any & value )
     throw( UnknownPropertyException, CannotConvertException, InvocationTargetException,RuntimeException)
 {
-    if( !hasProperty( aPropertyName ) )
+    PyThreadAttach guard( mInterpreter );
+    AdapterAttribute attr = getClass()->getAttribute( aPropertyName );
+    if( !attr.declared && !PyObject_HasAttr( mWrappedObject.get(), attr.name.get() ) )
     {
         OUStringBuffer buf;
         buf.appendAscii( "pyuno::Adapater: Property " ).append( aPropertyName );
@@ -375,14 +687,12 @@ void Adapter::setValue( const OUString & aPropertyName, const Any & value )
         throw UnknownPropertyException( buf.makeStringAndClear(), Reference< XInterface > () );
     }
 
-    PyThreadAttach guard( mInterpreter );
     try
     {
         Runtime runtime;
         PyRef obj = runtime.any2PyObject( value );
 
-        PyObject_SetAttrString(
-            mWrappedObject.get(), (char*)TO_ASCII(aPropertyName), obj.get() );
+        PyObject_SetAttr( mWrappedObject.get(), attr.name.get(), obj.get() );
         raiseInvocationTargetExceptionWhenNeeded( runtime);
 
     }
@@ -399,9 +709,9 @@ Any Adapter::getValue( const OUString & aPropertyName )
     PyThreadAttach guard( mInterpreter );
     {
         Runtime runtime;
+        AdapterAttribute attr = getClass()->getAttribute( aPropertyName );
         PyRef pyRef(
-            PyObject_GetAttrString( mWrappedObject.get(), (char*)TO_ASCII(aPropertyName) ),
-            SAL_NO_ACQUIRE );
+            PyObject_GetAttr( mWrappedObject.get(), attr.name.get() ), SAL_NO_ACQUIRE );
 
         raiseInvocationTargetExceptionWhenNeeded( runtime);
         if( !pyRef.is() )
@@ -425,11 +735,23 @@ sal_Bool Adapter::hasMethod( const OUString & aMethodName )
 sal_Bool Adapter::hasProperty( const OUString & aPropertyName )
     throw ( RuntimeException )
 {
+    {
+        // Invocation asks before each getValue, the names declared by an
+        // unchanged class are answered without the global interpreter lock
+        osl::MutexGuard classGuard( mClassMutex );
+        PyObject *type = *(PyObject * const volatile *) &mWrappedObject.get()->ob_type;
+        if( type == mpClass->getType() && mpClass->isDeclared( aPropertyName ) )
+            return sal_True;
+    }
+
     bool bRet = false;
     PyThreadAttach guard( mInterpreter );
     {
-        bRet = PyObject_HasAttrString(
-            mWrappedObject.get() , (char*) TO_ASCII( aPropertyName ));
+        // names provided by the class are answered from the cache, only names
+        // unknown to the class need to look at the instance itself
+        AdapterAttribute attr = getClass()->getAttribute( aPropertyName );
+        bRet = attr.declared ||
+            PyObject_HasAttr( mWrappedObject.get() , attr.name.get() );
     }
     return bRet;
 }
@@ -0,0 +1,527 @@
+/**************************************************************
+ * 
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ * 
+ *************************************************************/
+
+
+#include "pyuno_impl.hxx"
+
+#include <rtl/ustrbuf.hxx>
+#include <rtl/instance.hxx>
+#include <rtl/uuid.h>
+#include <osl/interlck.h>
+
+#include <typelib/typedescription.hxx>
+
+#include <uno/dispatcher.h>
+#include <uno/environment.hxx>
+#include <uno/mapping.hxx>
+#include <uno/data.h>
+#include <uno/any2.h>
+#include <uno/lbnames.h>
+
+#include <cppuhelper/exc_hlp.hxx>
+
+using rtl::OUString;
+using rtl::OUStringBuffer;
+
+using com::sun::star::uno::Any;
+using com::sun::star::uno::Environment;
+using com::sun::star::uno::Mapping;
+using com::sun::star::uno::Reference;
+using com::sun::star::uno::RuntimeException;
+using com::sun::star::uno::Sequence;
+using com::sun::star::uno::Type;
+using com::sun::star::uno::TypeDescription;
+using com::sun::star::uno::XInterface;
+using com::sun::star::reflection::InvocationTargetException;
+
+namespace pyuno
+{
+
+namespace {
+
+/** the binary UNO environment, in which the exported python objects live, and
+    the mappings between it and the C++ environment of the bridge
+ */
+struct BinaryEnvironment
+{
+    Environment unoEnv;
+    Mapping uno2cpp;
+    Mapping cpp2uno;
+    TypeDescription xInterfaceType;
+    OUString oidSuffix;
+    osl::Mutex mutex;
+
+    BinaryEnvironment();
+};
+
+BinaryEnvironment::BinaryEnvironment()
+    : unoEnv( OUString( RTL_CONSTASCII_USTRINGPARAM( UNO_LB_UNO ) ) ),
+      uno2cpp( OUString( RTL_CONSTASCII_USTRINGPARAM( UNO_LB_UNO ) ),
+               OUString( RTL_CONSTASCII_USTRINGPARAM( CPPU_CURRENT_LANGUAGE_BINDING_NAME ) ) ),
+      cpp2uno( OUString( RTL_CONSTASCII_USTRINGPARAM( CPPU_CURRENT_LANGUAGE_BINDING_NAME ) ),
+               OUString( RTL_CONSTASCII_USTRINGPARAM( UNO_LB_UNO ) ) ),
+      xInterfaceType( getCppuType( (Reference< XInterface > *) 0 ).getTypeLibType() )
+{
+    // the adapter address alone is only unique within this process
+    sal_uInt8 id[16];
+    rtl_createUuid( id, 0, sal_True );
+    OUStringBuffer buf( 64 );
+    buf.appendAscii( RTL_CONSTASCII_STRINGPARAM( ";pyuno[0];" ) );
+    for( int i = 0 ; i < 16 ; i ++ )
+        buf.append( (sal_Int32) id[i], 16 );
+    oidSuffix = buf.makeStringAndClear();
+}
+
+struct theBinaryEnvironment : public rtl::Static< BinaryEnvironment, theBinaryEnvironment > {};
+
+/** the binary UNO face of an Adapter for one interface type. The instances are
+    registered at the binary UNO environment, so every interface of an exported
+    python object exists only once.
+ */
+struct BinaryAdapter : public uno_Interface
+{
+    oslInterlockedCount nRef;
+    Adapter *pAdapter;
+    typelib_InterfaceTypeDescription *pTypeDescr;
+    OUString oid;
+
+    BinaryAdapter( Adapter *adapter, const OUString & rOid,
+                   typelib_InterfaceTypeDescription *typeDescr );
+    ~BinaryAdapter();
+};
+
+}
+
+extern "C"
+{
+
+static void SAL_CALL binaryAdapter_free( uno_ExtEnvironment *, void *pProxy )
+{
+    delete static_cast< BinaryAdapter * >( static_cast< uno_Interface * >( pProxy ) );
+}
+
+static void SAL_CALL binaryAdapter_acquire( uno_Interface *pUnoI )
+{
+    BinaryAdapter *that = static_cast< BinaryAdapter * >( pUnoI );
+    if( osl_incrementInterlockedCount( &that->nRef ) == 1 )
+    {
+        // the last release revoked the interface, register it again
+        uno_ExtEnvironment *pExtEnv = theBinaryEnvironment::get().unoEnv.get()->pExtEnv;
+        void *pThis = pUnoI;
+        (*pExtEnv->registerProxyInterface)(
+            pExtEnv, &pThis, binaryAdapter_free, that->oid.pData, that->pTypeDescr );
+        OSL_ASSERT( pThis == pUnoI );
+    }
+}
+
+static void SAL_CALL binaryAdapter_release( uno_Interface *pUnoI )
+{
+    BinaryAdapter *that = static_cast< BinaryAdapter * >( pUnoI );
+    if( ! osl_decrementInterlockedCount( &that->nRef ) )
+    {
+        // the environment calls binaryAdapter_free()
+        uno_ExtEnvironment *pExtEnv = theBinaryEnvironment::get().unoEnv.get()->pExtEnv;
+        (*pExtEnv->revokeInterface)( pExtEnv, pUnoI );
+    }
+}
+
+static void SAL_CALL binaryAdapter_dispatch(
+    uno_Interface *pUnoI, const typelib_TypeDescription *pMemberType,
+    void *pReturn, void *pArgs[], uno_Any **ppException );
+
+}
+
+BinaryAdapter::BinaryAdapter(
+    Adapter *adapter, const OUString & rOid, typelib_InterfaceTypeDescription *typeDescr )
+    : nRef( 1 ),
+      pAdapter( adapter ),
+      pTypeDescr( typeDescr ),
+      oid( rOid )
+{
+    uno_Interface::acquire = binaryAdapter_acquire;
+    uno_Interface::release = binaryAdapter_release;
+    uno_Interface::pDispatcher = binaryAdapter_dispatch;
+    pAdapter->acquire();
+    typelib_typedescription_acquire( &pTypeDescr->aBase );
+}
+
+BinaryAdapter::~BinaryAdapter()
+{
+    typelib_typedescription_release( &pTypeDescr->aBase );
+    pAdapter->release();
+}
+
+/** returns the acquired binary interface of the given type for the adapter
+ */
+static uno_Interface *getBinaryInterface(
+    Adapter *pAdapter, typelib_InterfaceTypeDescription *pTypeDescr )
+{
+    BinaryEnvironment & env = theBinaryEnvironment::get();
+    uno_ExtEnvironment *pExtEnv = env.unoEnv.get()->pExtEnv;
+
+    OUStringBuffer buf( 64 );
+    buf.append( sal::static_int_cast< sal_Int64 >(
+                    reinterpret_cast< sal_IntPtr >( pAdapter ) ), 16 );
+    buf.append( env.oidSuffix );
+    OUString oid( buf.makeStringAndClear() );
+
+    osl::MutexGuard guard( env.mutex );
+    void *pUnoI = 0;
+    (*pExtEnv->getRegisteredInterface)( pExtEnv, &pUnoI, oid.pData, pTypeDescr );
+    if( ! pUnoI )
+    {
+        pUnoI = static_cast< uno_Interface * >( new BinaryAdapter( pAdapter, oid, pTypeDescr ) );
+        (*pExtEnv->registerProxyInterface)(
+            pExtEnv, &pUnoI, binaryAdapter_free, oid.pData, pTypeDescr );
+    }
+    return static_cast< uno_Interface * >( pUnoI );
+}
+
+static bool isMember( const typelib_TypeDescription *pMemberType, const char *name, sal_Int32 length )
+{
+    return pMemberType->pTypeName->length == length &&
+        0 == rtl_ustr_ascii_shortenedCompare_WithLength(
+            pMemberType->pTypeName->buffer, length, name, length );
+}
+
+/** converts a binary UNO value to a C++ any */
+static Any unoValue2Any(
+    void *pValue, typelib_TypeDescriptionReference *pType, const BinaryEnvironment & env )
+{
+    Any ret;
+    uno_any_destruct( &ret, 0 ); // ret is void, only drops the type reference
+    uno_type_any_constructAndConvert( &ret, pValue, pType, env.uno2cpp.get() );
+    return ret;
+}
+
+/** returns the value converted to the given type, so that writeUnoValue()
+    cannot fail anymore */
+static Any convertToType(
+    const Runtime & runtime, const Any & value, typelib_TypeDescriptionReference *pType )
+{
+    if( pType->eTypeClass == typelib_TypeClass_ANY ||
+        typelib_typedescriptionreference_isAssignableFrom( pType, value.getValueTypeRef() ) )
+    {
+        return value;
+    }
+    if( ! value.hasValue() && pType->eTypeClass == typelib_TypeClass_INTERFACE )
+    {
+        // None for an interface
+        XInterface *pNull = 0;
+        return Any( &pNull, Type( pType ) );
+    }
+    return runtime.getImpl()->cargo->xTypeConverter->convertTo( value, Type( pType ) );
+}
+
+/** copies the value to uninitialized memory as binary UNO value */
+static void writeUnoValue(
+    void *pDest, const Any & value, typelib_TypeDescriptionReference *pType,
+    const BinaryEnvironment & env )
+{
+    void *pSource = pType->eTypeClass == typelib_TypeClass_ANY
+        ? const_cast< Any * >( &value ) : const_cast< void * >( value.getValue() );
+    uno_type_copyAndConvertData( pDest, pSource, pType, env.cpp2uno.get() );
+}
+
+static void setException(
+    uno_Any *pException, const Any & exc,
+    typelib_TypeDescriptionReference **ppDeclared, sal_Int32 nDeclared,
+    const BinaryEnvironment & env )
+{
+    bool bDeclared = typelib_typedescriptionreference_isAssignableFrom(
+        getCppuType( (RuntimeException *) 0 ).getTypeLibType(), exc.getValueTypeRef() );
+    for( sal_Int32 i = 0 ; ! bDeclared && i < nDeclared ; i ++ )
+        bDeclared = typelib_typedescriptionreference_isAssignableFrom(
+            ppDeclared[i], exc.getValueTypeRef() );
+
+    if( bDeclared )
+    {
+        uno_type_any_constructAndConvert(
+            pException, const_cast< void * >( exc.getValue() ), exc.getValueTypeRef(),
+            env.cpp2uno.get() );
+    }
+    else
+    {
+        // the caller does not expect it, so it can only be a RuntimeException
+        OUStringBuffer buf;
+        buf.appendAscii( "pyuno bridge: undeclared exception " );
+        buf.append( exc.getValueTypeName() );
+        if( exc.getValueTypeClass() == com::sun::star::uno::TypeClass_EXCEPTION )
+        {
+            buf.appendAscii( ": " );
+            buf.append( static_cast< const com::sun::star::uno::Exception * >(
+                            exc.getValue() )->Message );
+        }
+        RuntimeException e( buf.makeStringAndClear(), Reference< XInterface > () );
+        uno_type_any_constructAndConvert(
+            pException, &e, getCppuType( &e ).getTypeLibType(), env.cpp2uno.get() );
+    }
+}
+
+static void queryBinaryInterface( BinaryAdapter *that, void *pReturn, void *pArgs[] )
+{
+    typelib_TypeDescriptionReference *pType =
+        *static_cast< typelib_TypeDescriptionReference ** >( pArgs[0] );
+
+    bool bSupported = false;
+    if( pType->eTypeClass == typelib_TypeClass_INTERFACE )
+    {
+        Sequence< Type > types = that->pAdapter->getWrappedTypes();
+        for( sal_Int32 i = 0 ; ! bSupported && i < types.getLength() ; i ++ )
+            bSupported = typelib_typedescriptionreference_isAssignableFrom(
+                pType, types[i].getTypeLibType() );
+    }
+
+    TypeDescription type( pType );
+    if( bSupported && type.is() )
+    {
+        uno_Interface *pUnoI = getBinaryInterface(
+            that->pAdapter, reinterpret_cast< typelib_InterfaceTypeDescription * >( type.get() ) );
+        uno_any_construct( static_cast< uno_Any * >( pReturn ), &pUnoI, type.get(), 0 );
+        (*pUnoI->release)( pUnoI );
+    }
+    else
+    {
+        uno_any_construct( static_cast< uno_Any * >( pReturn ), 0, 0, 0 );
+    }
+}
+
+static void dispatchAttribute(
+    BinaryAdapter *that, const typelib_InterfaceAttributeTypeDescription *pAttribute,
+    void *pReturn, void *pArgs[], const BinaryEnvironment & env )
+{
+    Adapter *pAdapter = that->pAdapter;
+    OUString name( pAttribute->aBase.pMemberName );
+
+    PyThreadAttach guard( pAdapter->getInterpreter() );
+    {
+        Runtime runtime;
+        PyRef object = pAdapter->getWrappedObject();
+        AdapterAttribute attr = pAdapter->getClass()->getAttribute( name );
+        if( pReturn )
+        {
+            PyRef value( PyObject_GetAttr( object.get(), attr.name.get() ), SAL_NO_ACQUIRE );
+            raiseInvocationTargetExceptionWhenNeeded( runtime );
+            Any a( convertToType(
+                       runtime, runtime.pyObject2Any( value ), pAttribute->pAttributeTypeRef ) );
+            writeUnoValue( pReturn, a, pAttribute->pAttributeTypeRef, env );
+        }
+        else
+        {
+            PyRef value = runtime.any2PyObject(
+                unoValue2Any( pArgs[0], pAttribute->pAttributeTypeRef, env ) );
+            PyObject_SetAttr( object.get(), attr.name.get(), value.get() );
+            raiseInvocationTargetExceptionWhenNeeded( runtime );
+        }
+    }
+}
+
+static void dispatchMethod(
+    BinaryAdapter *that, const typelib_InterfaceMethodTypeDescription *pMethod,
+    void *pReturn, void *pArgs[], const BinaryEnvironment & env )
+{
+    Adapter *pAdapter = that->pAdapter;
+    OUString name( pMethod->aBase.pMemberName );
+
+    PyThreadAttach guard( pAdapter->getInterpreter() );
+    {
+        Runtime runtime;
+        RuntimeCargo *cargo = runtime.getImpl()->cargo;
+        PyRef object = pAdapter->getWrappedObject();
+
+        AdapterAttribute attr;
+        sal_Int32 nSelf = 0;
+        PyRef method = pAdapter->lookupMethod( name, attr, nSelf );
+        raiseInvocationTargetExceptionWhenNeeded( runtime );
+
+        sal_Int32 nParams = pMethod->nParams;
+        sal_Int32 nOuts = 0;
+        sal_Int32 i;
+        bool bLog = isLog( cargo, LogLevel::CALL );
+        Sequence< Any > logParams;
+        if( bLog )
+            logParams.realloc( nParams );
+
+        PyRef argsTuple( PyTuple_New( nSelf + nParams ), SAL_NO_ACQUIRE );
+        // fill tuple with default values in case of exceptions,
+        // pure out parameters are passed as None
+        for( i = nSelf ; i < nSelf + nParams ; i ++ )
+        {
+            Py_INCREF( Py_None );
+            PyTuple_SetItem( argsTuple.get(), i, Py_None );
+        }
+        if( nSelf )
+            PyTuple_SetItem( argsTuple.get(), 0, object.getAcquired() );
+
+        for( i = 0 ; i < nParams ; i ++ )
+        {
+            const typelib_MethodParameter & param = pMethod->pParams[i];
+            if( param.bOut )
+                nOuts ++;
+            if( param.bIn )
+            {
+                Any a( unoValue2Any( pArgs[i], param.pTypeRef, env ) );
+                PyRef val = runtime.any2PyObject( a );
+                PyTuple_SetItem( argsTuple.get(), nSelf + i, val.getAcquired() );
+                if( bLog )
+                    logParams[i] = a;
+            }
+        }
+        if( bLog )
+            logCall( cargo, "try     uno->py[0x", object.get(), name, logParams );
+
+        PyRef pyRet( PyObject_CallObject( method.get(), argsTuple.get() ), SAL_NO_ACQUIRE );
+        raiseInvocationTargetExceptionWhenNeeded( runtime );
+
+        // with out parameters, python returns ( return value, out parameters ... )
+        PyRef pyReturnValue( pyRet );
+        if( nOuts )
+        {
+            if( ! PyTuple_Check( pyRet.get() ) || PyTuple_Size( pyRet.get() ) != nOuts + 1 )
+            {
+                OUStringBuffer buf;
+                buf.appendAscii( "pyuno bridge: expected for method " );
+                buf.append( name );
+                buf.appendAscii( " one return value and " );
+                buf.append( nOuts );
+                buf.appendAscii( " out parameters as tuple" );
+                throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () );
+            }
+            pyReturnValue = PyTuple_GetItem( pyRet.get(), 0 );
+        }
+
+        // convert everything first, the caller does not clean up the values
+        // already written when an exception is reported
+        Any ret;
+        if( pMethod->pReturnTypeRef->eTypeClass != typelib_TypeClass_VOID )
+        {
+            ret = convertToType(
+                runtime, runtime.pyObject2Any( pyReturnValue ), pMethod->pReturnTypeRef );
+        }
+        Sequence< Any > outs( nOuts );
+        sal_Int32 nOut = 0;
+        for( i = 0 ; i < nParams ; i ++ )
+        {
+            if( pMethod->pParams[i].bOut )
+            {
+                outs[nOut] = convertToType(
+                    runtime, runtime.pyObject2Any( PyTuple_GetItem( pyRet.get(), 1 + nOut ) ),
+                    pMethod->pParams[i].pTypeRef );
+                nOut ++;
+            }
+        }
+
+        if( pMethod->pReturnTypeRef->eTypeClass != typelib_TypeClass_VOID )
+            writeUnoValue( pReturn, ret, pMethod->pReturnTypeRef, env );
+        nOut = 0;
+        for( i = 0 ; i < nParams ; i ++ )
+        {
+            const typelib_MethodParameter & param = pMethod->pParams[i];
+            if( param.bOut )
+            {
+                if( param.bIn )
+                    uno_type_destructData( pArgs[i], param.pTypeRef, 0 );
+                writeUnoValue( pArgs[i], outs[nOut], param.pTypeRef, env );
+                nOut ++;
+            }
+        }
+
+        if( bLog )
+            logReply( cargo, "success uno->py[0x", object.get(), name, ret, outs );
+    }
+}
+
+extern "C"
+{
+
+static void SAL_CALL binaryAdapter_dispatch(
+    uno_Interface *pUnoI, const typelib_TypeDescription *pMemberType,
+    void *pReturn, void *pArgs[], uno_Any **ppException )
+{
+    BinaryAdapter *that = static_cast< BinaryAdapter * >( pUnoI );
+    BinaryEnvironment & env = theBinaryEnvironment::get();
+
+    typelib_TypeDescriptionReference **ppExceptions = 0;
+    sal_Int32 nExceptions = 0;
+    try
+    {
+        if( pMemberType->eTypeClass == typelib_TypeClass_INTERFACE_ATTRIBUTE )
+        {
+            const typelib_InterfaceAttributeTypeDescription *pAttribute =
+                reinterpret_cast< const typelib_InterfaceAttributeTypeDescription * >(
+                    pMemberType );
+            ppExceptions = pReturn ? pAttribute->ppGetExceptions : pAttribute->ppSetExceptions;
+            nExceptions = pReturn ? pAttribute->nGetExceptions : pAttribute->nSetExceptions;
+            dispatchAttribute( that, pAttribute, pReturn, pArgs, env );
+        }
+        else if( isMember( pMemberType, RTL_CONSTASCII_STRINGPARAM(
+                               "com.sun.star.uno.XInterface::queryInterface" ) ) )
+        {
+            queryBinaryInterface( that, pReturn, pArgs );
+        }
+        else if( isMember( pMemberType, RTL_CONSTASCII_STRINGPARAM(
+                               "com.sun.star.lang.XUnoTunnel::getSomething" ) ) )
+        {
+            // uno object identity concept, always handled by the adapter directly
+            uno_Sequence *pId = *static_cast< uno_Sequence ** >( pArgs[0] );
+            Sequence< sal_Int8 > id(
+                reinterpret_cast< const sal_Int8 * >( pId->elements ), pId->nElements );
+            *static_cast< sal_Int64 * >( pReturn ) = that->pAdapter->getSomething( id );
+        }
+        else
+        {
+            const typelib_InterfaceMethodTypeDescription *pMethod =
+                reinterpret_cast< const typelib_InterfaceMethodTypeDescription * >(
+                    pMemberType );
+            ppExceptions = pMethod->ppExceptions;
+            nExceptions = pMethod->nExceptions;
+            dispatchMethod( that, pMethod, pReturn, pArgs, env );
+        }
+        *ppException = 0;
+    }
+    catch( InvocationTargetException & e )
+    {
+        setException( *ppException, e.TargetException, ppExceptions, nExceptions, env );
+    }
+    catch( com::sun::star::uno::Exception & )
+    {
+        // keeps the dynamic type, e.g. of a CannotConvertException
+        setException( *ppException, cppu::getCaughtException(),
+                      ppExceptions, nExceptions, env );
+    }
+}
+
+}
+
+Reference< XInterface > createBinaryAdapter( Adapter *pAdapter )
+{
+    BinaryEnvironment & env = theBinaryEnvironment::get();
+    typelib_InterfaceTypeDescription *pTypeDescr =
+        reinterpret_cast< typelib_InterfaceTypeDescription * >( env.xInterfaceType.get() );
+
+    uno_Interface *pUnoI = getBinaryInterface( pAdapter, pTypeDescr );
+    XInterface *pCppI = 0;
+    env.uno2cpp.mapInterface( reinterpret_cast< void ** >( &pCppI ), pUnoI, pTypeDescr );
+    (*pUnoI->release)( pUnoI );
+    return Reference< XInterface >( pCppI, SAL_NO_ACQUIRE );
+}
+
+}
@@ -22,9 +22,13 @@
 
 #include "pyuno_impl.hxx"
 
+#include <new>
+
 #include <osl/thread.h>
 #include <rtl/ustrbuf.hxx>
 
+#include <com/sun/star/beans/NamedValue.hpp>
+
 using rtl::OUStringToOString;
 using rtl::OUString;
 using com::sun::star::uno::Sequence;
@@ -38,62 +42,165 @@ using com::sun::star::uno::XComponentContext;
 using com::sun::star::lang::XSingleServiceFactory;
 using com::sun::star::script::XTypeConverter;
 using com::sun::star::script::XInvocation2;
+using com::sun::star::beans::NamedValue;
 
 namespace pyuno
 {
-typedef struct
+struct PyUNO_callable_Internals
 {
     Reference<XInvocation2> xInvocation;
     OUString methodName;
     ConversionMode mode;
-} PyUNO_callable_Internals;
+    bool bParamTypesRead;
+    Sequence< Type > paramTypes; // read at the first call with a mapping argument
+};
+
+/** @return whether the argument may be converted as named values, strings
+    and numbers are ruled out before the abstract class is asked
+*/
+static bool isMappingArgument( const Runtime & runtime, PyObject *arg )
+{
+    if( PyDict_Check( arg ) )
+        return true;
+#if PY_VERSION_HEX >= 0x03000000
+    if( PyUnicode_Check( arg ) || PyLong_Check( arg ) || PyFloat_Check( arg ) ||
+        PyTuple_Check( arg ) || PyList_Check( arg ) )
+        return false;
+#endif
+    return isMapping( runtime, arg );
+}
+
+/** @return whether the parameter is a sequence of NamedValue. Mappings are
+    converted to PropertyValues otherwise, so the parameter types are read
+    once, when a mapping is passed the first time.
+*/
+static bool isNamedValueParameter( PyUNO_callable_Internals & members, sal_Int32 nParam )
+{
+    if( ! members.bParamTypesRead )
+    {
+        Sequence< Type > paramTypes;
+        try
+        {
+            PyThreadDetach antiguard;
+            paramTypes = members.xInvocation->getInfoForName( members.methodName, sal_True ).aParamTypes;
+        }
+        catch( com::sun::star::uno::Exception & )
+        {
+            // no information, mappings stay PropertyValues
+        }
+        members.paramTypes = paramTypes;
+        members.bParamTypesRead = true;
+    }
+    return nParam < members.paramTypes.getLength() &&
+        members.paramTypes[nParam] == getCppuType( (Sequence< NamedValue > *) 0 );
+}
 
 typedef struct
 {
     PyObject_HEAD
-    PyUNO_callable_Internals* members;
+    PyUNO_callable_Internals members;
 } PyUNO_callable;
 
+#define PYUNO_CALLABLE_FREELIST_SIZE 64
+
+// released instances, only accessed with the global interpreter lock held
+static PyUNO_callable *g_freeList[PYUNO_CALLABLE_FREELIST_SIZE];
+static int g_nFree = 0;
+
 void PyUNO_callable_del (PyObject* self)
 {
     PyUNO_callable* me;
   
     me = (PyUNO_callable*) self;
-    delete me->members;
-    PyObject_Del (self);
+    me->members.~PyUNO_callable_Internals();
+    if( g_nFree < PYUNO_CALLABLE_FREELIST_SIZE )
+        g_freeList[g_nFree++] = me;
+    else
+        PyObject_Del (self);
   
     return;
 }
 
+#define CALL_FRAME_INLINE_ARGS 3
+
+/** The parameters of one call. The sequences for calls with up to
+    CALL_FRAME_INLINE_ARGS parameters are taken from a pool and given back
+    when the callee did not keep a reference, so that short calls don't
+    allocate in the steady state. Calls without parameters use the shared
+    empty sequence. Must be used with the global interpreter lock held.
+*/
+class CallFrame
+{
+    Sequence< Any > maParams;
+
+    static Sequence< Any > *getPool()
+    {
+        // one sequence per length, never deleted
+        static Sequence< Any > *pPool = new Sequence< Any >[ CALL_FRAME_INLINE_ARGS + 1 ];
+        return pPool;
+    }
+
+    CallFrame( const CallFrame & ); // not implemented
+    CallFrame & operator = ( const CallFrame & ); // not implemented
+
+public:
+    explicit CallFrame( sal_Int32 nParams )
+    {
+        if( nParams > 0 && nParams <= CALL_FRAME_INLINE_ARGS && getPool()[nParams].getLength() )
+        {
+            maParams = getPool()[nParams];
+            getPool()[nParams] = Sequence< Any >();
+        }
+        else if( nParams > 0 )
+            maParams.realloc( nParams );
+    }
+
+    ~CallFrame()
+    {
+        sal_Int32 nParams = maParams.getLength();
+        if( nParams > 0 && nParams <= CALL_FRAME_INLINE_ARGS && maParams.get()->nRefCount == 1 )
+        {
+            // the pool must not keep the arguments alive
+            Any *pParams = maParams.getArray();
+            for( sal_Int32 i = 0 ; i < nParams ; i ++ )
+                pParams[i].clear();
+            getPool()[nParams] = maParams;
+        }
+    }
+
+    /** precondition: the frame has parameters and holds the only reference */
+    Any *getArray() { return maParams.getArray(); }
+    const Sequence< Any > & getParams() const { return maParams; }
+};
+
 PyObject* PyUNO_callable_call (PyObject* self, PyObject* args, PyObject*)
 {
     PyUNO_callable* me;
 
     Sequence<short> aOutParamIndex;
     Sequence<Any> aOutParam;
-    Sequence<Any> aParams;
-    Sequence<Type> aParamTypes;
-    Any any_params;
-    Any out_params;
     Any ret_value;
     RuntimeCargo *cargo = 0;
     me = (PyUNO_callable*) self;
   
     PyRef ret;
+    CallFrame frame( PyTuple_Size( args ) );
+    const Sequence<Any> & aParams = frame.getParams();
     try
     {
         Runtime runtime;
         cargo = runtime.getImpl()->cargo;
-        any_params = runtime.pyObject2Any (args, me->members->mode);
-    
-        if (any_params.getValueTypeClass () == com::sun::star::uno::TypeClass_SEQUENCE)
-        {
-            any_params >>= aParams;
-        }
-        else
+        if( aParams.getLength() )
         {
-            aParams.realloc (1);
-            aParams [0] <<= any_params;
+            Any *pParams = frame.getArray();
+            for( sal_Int32 i = 0 ; i < aParams.getLength() ; i ++ )
+            {
+                PyObject *arg = PyTuple_GET_ITEM( args, i );
+                if( isMappingArgument( runtime, arg ) && isNamedValueParameter( me->members, i ) )
+                    pParams[i] = mapping2NamedValues( runtime, arg, true, me->members.mode );
+                else
+                    pParams[i] = runtime.pyObject2Any( arg, me->members.mode );
+            }
         }
 
         {
@@ -102,19 +209,19 @@ PyObject* PyUNO_callable_call (PyObject* self, PyObject* args, PyObject*)
             // do some logging if desired ... 
             if( isLog( cargo, LogLevel::CALL ) )
             {
-                logCall( cargo, "try     py->uno[0x", me->members->xInvocation.get(),
-                         me->members->methodName, aParams );
+                logCall( cargo, "try     py->uno[0x", me->members.xInvocation.get(),
+                         me->members.methodName, aParams );
             }
 
             // do the call
-            ret_value = me->members->xInvocation->invoke (
-                me->members->methodName, aParams, aOutParamIndex, aOutParam);
+            ret_value = me->members.xInvocation->invoke (
+                me->members.methodName, aParams, aOutParamIndex, aOutParam);
 
             // log the reply, if desired
             if( isLog( cargo, LogLevel::CALL ) )
             {
-                logReply( cargo, "success py->uno[0x", me->members->xInvocation.get(),
-                          me->members->methodName, ret_value, aOutParam);
+                logReply( cargo, "success py->uno[0x", me->members.xInvocation.get(),
+                          me->members.methodName, ret_value, aOutParam);
             }
         }
         
@@ -150,8 +257,8 @@ PyObject* PyUNO_callable_call (PyObject* self, PyObject* args, PyObject*)
         
         if( isLog( cargo, LogLevel::CALL ) )
         {
-            logException( cargo, "except  py->uno[0x", me->members->xInvocation.get() ,
-                          me->members->methodName, e.TargetException.getValue(), e.TargetException.getValueTypeRef());
+            logException( cargo, "except  py->uno[0x", me->members.xInvocation.get() ,
+                          me->members.methodName, e.TargetException.getValue(), e.TargetException.getValueTypeRef());
         }
         raisePyExceptionWithAny( e.TargetException );
     }
@@ -159,8 +266,8 @@ PyObject* PyUNO_callable_call (PyObject* self, PyObject* args, PyObject*)
     {
         if( isLog( cargo, LogLevel::CALL ) )
         {
-            logException( cargo, "error  py->uno[0x", me->members->xInvocation.get() ,
-                          me->members->methodName, &e, getCppuType(&e).getTypeLibType());
+            logException( cargo, "error  py->uno[0x", me->members.xInvocation.get() ,
+                          me->members.methodName, &e, getCppuType(&e).getTypeLibType());
         }
         raisePyExceptionWithAny( com::sun::star::uno::makeAny( e ) );
     }
@@ -168,8 +275,8 @@ PyObject* PyUNO_callable_call (PyObject* self, PyObject* args, PyObject*)
     {
         if( isLog( cargo, LogLevel::CALL ) )
         {
-            logException( cargo, "error  py->uno[0x", me->members->xInvocation.get() ,
-                          me->members->methodName, &e, getCppuType(&e).getTypeLibType());
+            logException( cargo, "error  py->uno[0x", me->members.xInvocation.get() ,
+                          me->members.methodName, &e, getCppuType(&e).getTypeLibType());
         }
         raisePyExceptionWithAny( com::sun::star::uno::makeAny( e ) );
     }
@@ -177,8 +284,8 @@ PyObject* PyUNO_callable_call (PyObject* self, PyObject* args, PyObject*)
     {
         if( cargo && isLog( cargo, LogLevel::CALL ) )
         {
-            logException( cargo, "error  py->uno[0x", me->members->xInvocation.get() ,
-                          me->members->methodName, &e, getCppuType(&e).getTypeLibType());
+            logException( cargo, "error  py->uno[0x", me->members.xInvocation.get() ,
+                          me->members.methodName, &e, getCppuType(&e).getTypeLibType());
         }
         raisePyExceptionWithAny( com::sun::star::uno::makeAny( e ) );
     }
@@ -256,14 +363,23 @@ PyRef PyUNO_callable_new (
 {
     PyUNO_callable* self;
   
-    self = PyObject_New (PyUNO_callable, &PyUNO_callable_Type);
-    if (self == NULL)
-        return NULL; //NULL == Error!
-
-    self->members = new PyUNO_callable_Internals;
-    self->members->xInvocation = my_inv;
-    self->members->methodName = methodName;
-    self->members->mode = mode;
+    if( g_nFree )
+    {
+        self = g_freeList[--g_nFree];
+        PyObject_Init( (PyObject*)self, &PyUNO_callable_Type );
+    }
+    else
+    {
+        self = PyObject_New (PyUNO_callable, &PyUNO_callable_Type);
+        if (self == NULL)
+            return NULL; //NULL == Error!
+    }
+
+    new ( &self->members ) PyUNO_callable_Internals();
+    self->members.xInvocation = my_inv;
+    self->members.methodName = methodName;
+    self->members.mode = mode;
+    self->members.bParamTypesRead = false;
 
     return PyRef( (PyObject*)self, SAL_NO_ACQUIRE );
 }
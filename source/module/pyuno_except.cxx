@@ -48,8 +48,9 @@ void raisePyExceptionWithAny( const com::sun::star::uno::Any &anyExc )
         PyRef exc = runtime.any2PyObject( anyExc );
         if( exc.is() )
         {
-            PyRef type( getClass( anyExc.getValueType().getTypeName(),runtime ) );
-            PyErr_SetObject( type.get(), exc.get());
+            // the instance is of the class generated for the exception type,
+            // its args are built when python first reads them
+            PyErr_SetObject( (PyObject *) Py_TYPE( exc.get() ), exc.get() );
         }
         else
         {
@@ -162,9 +163,18 @@ static PyRef createClass( const OUString & name, const Runtime &runtime )
         bases = PyRef( PyTuple_New( 0 ), SAL_NO_ACQUIRE );
     }
 
+    PyRef dict( PyDict_New(), SAL_NO_ACQUIRE );
+    if( ! isInterface )
+    {
+        // one descriptor per member, reading and writing the embedded UNO
+        // value, is added once the class exists
+        desc.makeComplete();
+        addStructMembers( dict.get(), (typelib_CompoundTypeDescription*)desc.get() );
+    }
+
     PyTuple_SetItem( args.get(), 0, pyTypeName.getAcquired());
     PyTuple_SetItem( args.get(), 1, bases.getAcquired() );
-    PyTuple_SetItem( args.get(), 2, PyDict_New() );
+    PyTuple_SetItem( args.get(), 2, dict.getAcquired() );
     
 #if PY_VERSION_HEX > 0x03000000
     PyRef ret(
@@ -188,8 +198,9 @@ static PyRef createClass( const OUString & name, const Runtime &runtime )
             ustring2PyString(name).get() );
 #endif
     }
-    else
+    else if( ret.is() )
     {
+        addStructDescriptors( ret.get() );
 #if PY_VERSION_HEX >= 0x03000000
         PyObject_SetAttrString(
             ret.get(), const_cast< char * >("__pyunostruct__"),
@@ -211,38 +222,141 @@ static PyRef createClass( const OUString & name, const Runtime &runtime )
 
 bool isInstanceOfStructOrException( PyObject *obj)
 {
-    PyRef attr(
-        PyObject_GetAttrString(obj, const_cast< char * >("__class__")),
-        SAL_NO_ACQUIRE );
-    return PyObject_HasAttrString(
-        attr.get(), const_cast< char * >("__pyunostruct__"));
+    return getStructData( obj ) != 0;
+}
+
+/** @return the own dict of a class or 0 */
+static PyObject *getClassDict( PyObject *obj )
+{
+#if PY_VERSION_HEX >= 0x03000000
+    if( PyType_Check( obj ) )
+        return reinterpret_cast< PyTypeObject * >( obj )->tp_dict;
+#else
+    if( PyClass_Check( obj ) )
+        return reinterpret_cast< PyClassObject * >( obj )->cl_dict;
+#endif
+    return 0;
 }
 
-sal_Bool isInterfaceClass( const Runtime &runtime, PyObject * obj )
+sal_Bool isInterfaceClass( const Runtime &, PyObject * obj )
 {
-    const ClassSet & set = runtime.getImpl()->cargo->interfaceSet;
-    return set.find( obj ) != set.end();
+    // only the generated class itself has the attribute in its own dict,
+    // python classes implementing the interface inherit it
+    PyObject *dict = getClassDict( obj );
+    return dict && PyDict_GetItemString( dict, "__pyunointerface__" );
 }
 
-PyRef getClass( const OUString & name , const Runtime &runtime)
+PyRef ClassCache::lookup( const OUString & name )
 {
-    PyRef ret;
-    
-    RuntimeCargo *cargo =runtime.getImpl()->cargo;
-    ExceptionClassMap::iterator ii = cargo->exceptionMap.find( name );
-    if( ii == cargo->exceptionMap.end() )
+    EntryMap::iterator ii = mEntries.find( name );
+    if( ii != mEntries.end() )
     {
-        ret = createClass( name, runtime );
-        cargo->exceptionMap[name] = ret;
-        if( PyObject_HasAttrString(
-                ret.get(), const_cast< char * >("__pyunointerface__") ) )
-            cargo->interfaceSet.insert( ret );
+        mLru.splice( mLru.begin(), mLru, ii->second.lru );
+        return ii->second.clazz;
     }
-    else
+    WeakClassMap::iterator jj = mDropped.find( name );
+    if( jj != mDropped.end() )
+    {
+        PyRef clazz( PyWeakref_GetObject( jj->second.get() ) );
+        mDropped.erase( jj );
+        if( clazz.is() && clazz.get() != Py_None )
+        {
+            insert( name, clazz );
+            return clazz;
+        }
+    }
+    return PyRef();
+}
+
+void ClassCache::insert( const OUString & name, const PyRef & clazz )
+{
+    mLru.push_front( name );
+    Entry & entry = mEntries[ name ];
+    entry.clazz = clazz;
+    entry.lru = mLru.begin();
+    shrink();
+}
+
+sal_Int32 ClassCache::setLimit( sal_Int32 nLimit )
+{
+    sal_Int32 nOld = mnLimit;
+    mnLimit = nLimit > 0 ? nLimit : 0;
+    shrink();
+    return nOld;
+}
+
+void ClassCache::shrink()
+{
+    if( ! mnLimit )
+        return;
+    while( (sal_Int32) mEntries.size() > mnLimit )
+    {
+        EntryMap::iterator ii = mEntries.find( mLru.back() );
+        PyRef weak( PyWeakref_NewRef( ii->second.clazz.get(), 0 ), SAL_NO_ACQUIRE );
+        if( weak.is() )
+            mDropped[ ii->first ] = weak;
+        else
+            PyErr_Clear();
+        mEntries.erase( ii );
+        mLru.pop_back();
+    }
+    if( (sal_Int32) mDropped.size() > 2 * mnLimit + 64 )
+        pruneDropped();
+}
+
+void ClassCache::pruneDropped()
+{
+    WeakClassMap::iterator ii = mDropped.begin();
+    while( ii != mDropped.end() )
     {
-        ret = ii->second;
+        if( PyWeakref_GetObject( ii->second.get() ) == Py_None )
+            mDropped.erase( ii++ );
+        else
+            ++ii;
     }
+}
 
+sal_Int32 ClassCache::getDroppedCount()
+{
+    pruneDropped();
+    return (sal_Int32) mDropped.size();
+}
+
+static sal_Int64 sizeOf( PyObject *obj )
+{
+    PyRef size( PyObject_CallMethod( obj, const_cast< char * >("__sizeof__"), 0 ), SAL_NO_ACQUIRE );
+    if( ! size.is() )
+    {
+        PyErr_Clear();
+        return 0;
+    }
+    return PyLong_AsLongLong( size.get() );
+}
+
+sal_Int64 ClassCache::getMemory() const
+{
+    sal_Int64 n = 0;
+    for( EntryMap::const_iterator ii = mEntries.begin() ; ii != mEntries.end() ; ++ii )
+    {
+        PyObject *clazz = ii->second.clazz.get();
+        n += sizeOf( clazz ) + getStructClassMemory( clazz );
+        PyObject *dict = getClassDict( clazz );
+        if( dict )
+            n += sizeOf( dict );
+    }
+    return n;
+}
+
+PyRef getClass( const OUString & name , const Runtime &runtime)
+{
+    ClassCache & cache = runtime.getImpl()->cargo->classCache;
+    PyRef ret = cache.lookup( name );
+    if( ! ret.is() )
+    {
+        ret = createClass( name, runtime );
+        if( ret.is() )
+            cache.insert( name, ret );
+    }
     return ret;
 }
 
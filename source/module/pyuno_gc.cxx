@@ -21,7 +21,11 @@
 
 
 #include <pyuno_impl.hxx>
-#include <osl/thread.hxx>
+#include <osl/mutex.hxx>
+#include <rtl/instance.hxx>
+
+#include <vector>
+
 namespace pyuno
 {
 
@@ -42,72 +46,98 @@ static bool isAfterUnloadOrPy_Finalize()
         !Py_IsInitialized();
 }
 
-class GCThread : public ::osl::Thread
+namespace {
+
+struct PendingObject
 {
-    PyObject *mPyObject;
-    PyInterpreterState *mPyInterpreter;
-    GCThread( const GCThread & ); // not implemented
-    GCThread &operator =( const GCThread & ); // not implemented
-    
-public:
-    GCThread( PyInterpreterState *interpreter, PyObject * object );
-    virtual void SAL_CALL run();
-    virtual void SAL_CALL onTerminated();
+    PyInterpreterState *interpreter;
+    PyObject *object;
 };
 
+/** python objects, whose last reference got released by UNO threads, which
+    don't hold the global interpreter lock */
+struct PendingObjects
+{
+    osl::Mutex mutex;
+    ::std::vector< PendingObject > objects;
+    bool bCallScheduled;
+
+    PendingObjects() : bCallScheduled( false ) {}
+};
+
+struct thePendingObjects : public rtl::Static< PendingObjects, thePendingObjects > {};
+
+}
+
+extern "C" {
+
+static int releasePendingPyObjectsCall( void * )
+{
+    {
+        PendingObjects & pending = thePendingObjects::get();
+        osl::MutexGuard guard( pending.mutex );
+        pending.bCallScheduled = false;
+    }
+    releasePendingPyObjects();
+    return 0;
+}
 
-GCThread::GCThread( PyInterpreterState *interpreter, PyObject * object ) :
-    mPyObject( object ), mPyInterpreter( interpreter )
-{}
+}
 
-void GCThread::run()
+void releasePendingPyObjects()
 {
-    //  otherwise we crash here, when main has been left already
     if( isAfterUnloadOrPy_Finalize() )
         return;
-    try
+    PendingObjects & pending = thePendingObjects::get();
+    ::std::vector< PyObject * > objects;
     {
-        PyThreadAttach g( (PyInterpreterState*)mPyInterpreter );
+        PyInterpreterState *interpreter = PyThreadState_Get()->interp;
+        ::std::vector< PendingObject > others;
+        osl::MutexGuard guard( pending.mutex );
+        if( pending.objects.empty() )
+            return;
+        for( ::std::vector< PendingObject >::const_iterator ii = pending.objects.begin();
+             ii != pending.objects.end() ; ++ii )
         {
-            Runtime runtime;
-
-            // remove the reference from the pythonobject2adapter map
-            PyRef2Adapter::iterator ii =
-                runtime.getImpl()->cargo->mappedObjects.find( mPyObject );
-            if( ii != runtime.getImpl()->cargo->mappedObjects.end() )
-            {
-                runtime.getImpl()->cargo->mappedObjects.erase( ii );
-            }
-            
-            Py_XDECREF( mPyObject );
+            if( ii->interpreter == interpreter )
+                objects.push_back( ii->object );
+            else
+                others.push_back( *ii );
         }
+        pending.objects.swap( others );
     }
-    catch( com::sun::star::uno::RuntimeException & e )
+
+    // may run arbitrary python code, so the mutex must not be held anymore
+    for( ::std::vector< PyObject * >::iterator ii = objects.begin() ;
+         ii != objects.end() ; ++ii )
     {
-        rtl::OString msg;
-        msg = rtl::OUStringToOString( e.Message, RTL_TEXTENCODING_ASCII_US );
-        fprintf( stderr, "Leaking python objects bridged to UNO for reason %s\n",msg.getStr());
+        Py_XDECREF( *ii );
     }
 }
 
-
-void GCThread::onTerminated()
-{
-    delete this;
-}
-
 void decreaseRefCount( PyInterpreterState *interpreter, PyObject *object )
 {
     //  otherwise we crash in the last after main ...
     if( isAfterUnloadOrPy_Finalize() )
         return;
 
-    // delegate to a new thread, because there does not seem
-    // to be a method, which tells, whether the global
-    // interpreter lock is held or not
-    // TODO: Look for a more efficient solution
-    osl::Thread *t = new GCThread( interpreter, object );
-    t->create();
+    // there is no method, which tells, whether the global interpreter lock
+    // is held or not, so the release is queued. The queue is emptied by a
+    // pending call or by the next UNO thread leaving python
+    PendingObjects & pending = thePendingObjects::get();
+    bool bSchedule = false;
+    {
+        osl::MutexGuard guard( pending.mutex );
+        PendingObject entry = { interpreter, object };
+        pending.objects.push_back( entry );
+        bSchedule = ! pending.bCallScheduled;
+        pending.bCallScheduled = true;
+    }
+    if( bSchedule && Py_AddPendingCall( releasePendingPyObjectsCall, 0 ) != 0 )
+    {
+        osl::MutexGuard guard( pending.mutex );
+        pending.bCallScheduled = false;
+    }
 }
 
 }
@@ -27,6 +27,8 @@
 
 #include <hash_map>
 #include <hash_set>
+#include <list>
+#include <vector>
 
 #include <com/sun/star/beans/XIntrospection.hpp>
 #include <com/sun/star/script/XTypeConverter.hpp>
@@ -34,6 +36,7 @@
 #include <com/sun/star/script/XInvocationAdapterFactory2.hpp>
 
 #include <com/sun/star/reflection/XIdlReflection.hpp>
+#include <com/sun/star/reflection/XTypeDescription.hpp>
 
 #include <com/sun/star/container/XHierarchicalNameAccess.hpp>
 
@@ -43,6 +46,13 @@
 #include <cppuhelper/implbase2.hxx>
 #include <cppuhelper/weakref.hxx>
 
+#include <osl/mutex.hxx>
+#include <osl/interlck.h>
+
+#if PY_VERSION_HEX < 0x03020000
+typedef long Py_hash_t;
+#endif
+
 namespace pyuno
 {
 
@@ -73,25 +83,73 @@ void logException( RuntimeCargo *cargo, const char *intro,
                    const void * data, const com::sun::star::uno::Type & type );
 static const sal_Int32 VAL2STR_MODE_DEEP = 0;
 static const sal_Int32 VAL2STR_MODE_SHALLOW = 1;
-rtl::OUString val2str( const void * pVal, typelib_TypeDescriptionReference * pTypeRef, sal_Int32 mode = VAL2STR_MODE_DEEP ) SAL_THROW( () );
+static const sal_Int32 VAL2STR_MAX_DEPTH = 8;
+static const sal_Int32 VAL2STR_MAX_ELEMENTS = 100;
+static const sal_Int32 VAL2STR_MAX_LENGTH = 8192;
+/** renders a UNO value for repr() and the log. Values nested deeper than
+    nMaxDepth, sequence elements beyond nMaxElements and output beyond
+    nMaxLength characters are elided with "...". Only VAL2STR_MODE_DEEP asks
+    the outermost interface for its services and types, which may be
+    remote calls.
+*/
+rtl::OUString val2str( const void * pVal, typelib_TypeDescriptionReference * pTypeRef,
+                       sal_Int32 mode = VAL2STR_MODE_SHALLOW,
+                       sal_Int32 nMaxDepth = VAL2STR_MAX_DEPTH,
+                       sal_Int32 nMaxElements = VAL2STR_MAX_ELEMENTS,
+                       sal_Int32 nMaxLength = VAL2STR_MAX_LENGTH ) SAL_THROW( () );
 //--------------------------------------------------
 
-typedef ::std::hash_map
-<
-    PyRef,
-    com::sun::star::uno::WeakReference< com::sun::star::script::XInvocation >,
-    PyRef::Hash,
-    std::equal_to< PyRef >
-> PyRef2Adapter;
-
+/** the generated struct, exception and interface classes by type name.
+    The cache may be bounded, the least recently used classes are dropped
+    first. Dropped classes are remembered weakly and reused while they are
+    alive, so a class is only rebuilt when no python code can refer to it.
+*/
+class ClassCache
+{
+    struct Entry
+    {
+        PyRef clazz;
+        std::list< rtl::OUString >::iterator lru;
+    };
+    typedef ::std::hash_map
+    <
+        rtl::OUString,
+        Entry,
+        rtl::OUStringHash,
+        std::equal_to< rtl::OUString >
+    > EntryMap;
+    typedef ::std::hash_map
+    <
+        rtl::OUString,
+        PyRef,
+        rtl::OUStringHash,
+        std::equal_to< rtl::OUString >
+    > WeakClassMap;
+
+    EntryMap mEntries;
+    WeakClassMap mDropped;              // weak references
+    std::list< rtl::OUString > mLru;    // most recently used first
+    sal_Int32 mnLimit;                  // 0 for no limit
+
+    void shrink();
+    void pruneDropped();
 
-typedef ::std::hash_map
-<
-rtl::OUString,
-PyRef,
-rtl::OUStringHash,
-std::equal_to<rtl::OUString>
-> ExceptionClassMap;
+public:
+    ClassCache() : mnLimit( 0 ) {}
+
+    /** @return the class or an empty reference */
+    PyRef lookup( const rtl::OUString & name );
+    void insert( const rtl::OUString & name, const PyRef & clazz );
+
+    /** @return the previous limit */
+    sal_Int32 setLimit( sal_Int32 nLimit );
+    sal_Int32 getLimit() const { return mnLimit; }
+    sal_Int32 getCount() const { return (sal_Int32) mEntries.size(); }
+    /** @return the number of dropped classes, which are still alive */
+    sal_Int32 getDroppedCount();
+    /** @return the approximate memory of the cached classes in bytes */
+    sal_Int64 getMemory() const;
+};
 
 typedef ::std::hash_map
 <
@@ -101,33 +159,99 @@ typedef ::std::hash_map
     std::equal_to< rtl::OUString >
 > MethodOutIndexMap;
 
-typedef ::std::hash_set< PyRef , PyRef::Hash , std::equal_to<PyRef> > ClassSet;
-
-PyObject* PyUNO_new(
-    const com::sun::star::uno::Any & targetInterface,
-    const com::sun::star::uno::Reference<com::sun::star::lang::XSingleServiceFactory> & ssf);
-
-PyObject* PyUNO_new_UNCHECKED (
-    const com::sun::star::uno::Any & targetInterface,
-    const com::sun::star::uno::Reference<com::sun::star::lang::XSingleServiceFactory> & ssf);
+struct InterfacePointerHash
+{
+    sal_IntPtr operator () ( const com::sun::star::uno::XInterface *p ) const
+    { return sal_IntPtr( p ); }
+};
 
-typedef struct
+/** the living PyUNO wrappers by the normalized XInterface pointer of the
+    wrapped object. The map holds no references, a wrapper removes its
+    entry when it is destroyed.
+*/
+typedef ::std::hash_map
+<
+    com::sun::star::uno::XInterface *,
+    PyObject *,
+    InterfacePointerHash,
+    std::equal_to< com::sun::star::uno::XInterface * >
+> WrapperMap;
+
+/** @return the wrapper of the interface, an existing one if the object
+    is already wrapped with the same interface type
+*/
+PyObject* PyUNO_new( const com::sun::star::uno::Any & targetInterface, const Runtime &runtime );
+
+struct PyUNOInternals
 {
     com::sun::star::uno::Reference <com::sun::star::script::XInvocation2> xInvocation;
     com::sun::star::uno::Any wrappedObject;
-} PyUNOInternals;
+    // held, so that a proxy of the normalized interface stays the key in the WrapperMap
+    com::sun::star::uno::Reference< com::sun::star::uno::XInterface > xNormalized;
+    PyRef runtime;
+};
 
+/** The C++ members are constructed in place, instances are recycled through
+    a free list.
+*/
 typedef struct
 {
     PyObject_HEAD
-    PyUNOInternals* members;
+    PyUNOInternals members;
+    PyObject *weakreflist;
 } PyUNO;
 
+struct StructValue;
+
+/** UNO struct or exception value of a python instance. The value may be
+    shared with other instances, pData must not be written directly.
+*/
+struct PyUNOStructData
+{
+    typelib_TypeDescription *pTypeDescr;
+    void *pData;
+    StructValue *pValue;
+};
+
+typedef struct
+{
+    PyObject_HEAD
+    PyUNOStructData value;
+} PyUNOStruct;
+
+typedef struct
+{
+    PyBaseExceptionObject exc;
+    PyUNOStructData value;
+    bool bArgsPending; // args are built from the Message when first read
+} PyUNOException;
+
+/** @return the embedded UNO value or 0 if obj is no struct or exception instance */
+PyUNOStructData *getStructData( PyObject *obj );
+PyRef PyUNOStruct_new( const com::sun::star::uno::Any &a, const Runtime &r );
+void addStructMembers( PyObject *dict, typelib_CompoundTypeDescription *pCompType );
+/** adds the member descriptors to a class created from a dict filled by
+    addStructMembers, the descriptors keep the class and its member tables alive */
+void addStructDescriptors( PyObject *clazz );
+/** @return the memory of the member tables of a struct class, 0 for other objects */
+sal_Int64 getStructClassMemory( PyObject *clazz );
+bool initStructTypes( PyObject *module );
+
+/** lazy view of a UNO sequence, elements are converted on access */
+PyRef PyUNOSequence_new( const com::sun::star::uno::Any &a, const Runtime &r );
+bool PyUNOSequence_Check( PyObject *obj );
+com::sun::star::uno::Any PyUNOSequence_getValue( PyObject *obj );
+bool initSequenceType( PyObject *module );
+
 PyRef ustring2PyUnicode( const rtl::OUString &source );
+PyRef ustring2PyInternedString( const rtl::OUString &source );
 #if PY_VERSION_HEX < 0x03000000
 PyRef ustring2PyString( const ::rtl::OUString & source );
 #endif
 rtl::OUString pyString2ustring( PyObject *str );
+/** @return the ascii string as UNO string, short strings reuse a scratch
+    string of the calling thread once no other reference to it is left */
+rtl::OUString getScratchString( const char *ascii );
 
     
 PyRef AnyToPyObject (const com::sun::star::uno::Any & a, const Runtime &r )
@@ -152,6 +276,11 @@ PyRef PyUNO_callable_new (
 PyObject* PyUNO_Type_new (const char *typeName , com::sun::star::uno::TypeClass t , const Runtime &r );
 PyObject* PyUNO_Enum_new( const char *enumBase, const char *enumValue, const Runtime &r );
 PyObject* PyUNO_char_new (sal_Unicode c , const Runtime &r);
+/** @return the uno.Enum of the value, throws RuntimeException for unknown values */
+PyObject *PyUNO_Enum_fromValue( typelib_TypeDescriptionReference *pTypeRef, sal_Int32 nValue );
+PyObject *PyUNO_Enum_fromIndex( typelib_EnumTypeDescription *pEnumDesc, sal_Int32 nIndex );
+PyObject *PyUNO_Type_fromRef( typelib_TypeDescriptionReference *pTypeRef );
+bool initValueTypes( PyObject *module );
 PyObject *PyUNO_ByteSequence_new( const com::sun::star::uno::Sequence< sal_Int8 > &, const Runtime &r );
 
 PyObject *importToGlobal( PyObject *typeName, PyObject *dict, PyObject *targetName );
@@ -161,6 +290,17 @@ PyRef getEnumClass( const Runtime &);
 PyRef getBoolClass( const Runtime &);
 PyRef getCharClass( const Runtime &);
 PyRef getByteSequenceClass( const Runtime & );
+PyRef getSequenceABC( const Runtime & );
+PyRef getMappingABC( const Runtime & );
+
+/** dicts and collections.abc.Mapping instances are converted as named values */
+bool isMapping( const Runtime & r, PyObject *o );
+
+/** converts a mapping with string keys to a sequence of PropertyValue or
+    NamedValue in one pass over its items
+*/
+com::sun::star::uno::Any mapping2NamedValues(
+    const Runtime & r, PyObject *mapping, bool bNamedValue, enum ConversionMode mode );
 PyRef getPyUnoClass();
 PyRef getClass( const rtl::OUString & name , const Runtime & runtime );
 PyRef getAnyClass( const Runtime &);
@@ -185,9 +325,207 @@ PyRef getObjectFromUnoModule( const Runtime &runtime, const char * object )
 
 sal_Bool isInterfaceClass( const Runtime &, PyObject *obj );
 bool isInstanceOfStructOrException( PyObject *obj);
+
+/** @return whether the type is a polymorphic struct or derives from one */
+bool isPolymorphicStruct(
+    const com::sun::star::uno::Reference< com::sun::star::reflection::XTypeDescription > & xType );
 com::sun::star::uno::Sequence<com::sun::star::uno::Type> implementsInterfaces(
     const Runtime & runtime, PyObject *obj );
 
+/** cached lookup result of one attribute name on the class of an exported
+    python object, see AdapterClass
+ */
+struct AdapterAttribute
+{
+    /** the interned python string of the attribute name */
+    PyRef name;
+
+    /** the plain python function found on the class, which can be called
+        without creating a bound method first. Not set, when the attribute
+        is something else or is not found on the class at all */
+    PyRef function;
+
+    /** tp_version_tag of the class at the time of the lookup, 0 if the class
+        did not provide a valid tag */
+    unsigned int versionTag;
+
+    /** getTypes or getImplementationId, their return values are never
+        interpreted as out parameter tuples */
+    sal_Bool typeProviderMethod;
+
+    /** the class itself provides the attribute, so every instance has it.
+        Not set for data descriptors like properties, they may still fail */
+    sal_Bool declared;
+
+    AdapterAttribute()
+        : versionTag( 0 ), typeProviderMethod( sal_False ), declared( sal_False ) {}
+};
+
+typedef ::std::hash_map
+<
+    rtl::OUString,
+    AdapterAttribute,
+    rtl::OUStringHash,
+    std::equal_to< rtl::OUString >
+> AdapterAttributeMap;
+
+/** keeps the resolved attributes of one python class, which has instances
+    exported to UNO. All adapters of instances of the same class share it.
+
+    Entries get resolved again, when the version tag of the class has changed
+    (the python runtime invalidates it whenever the class gets modified).
+
+    Refcounted, the runtime cargo and every adapter hold a reference, as
+    adapters may outlive the runtime. The last release may happen without
+    the global interpreter lock, the python references are queued then.
+ */
+class AdapterClass
+{
+    oslInterlockedCount mRefCount;
+    PyInterpreterState *mInterpreter;
+    PyRef mType;
+    osl::Mutex mMutex;
+    AdapterAttributeMap mAttributes;
+
+    AdapterClass( const AdapterClass & ); // not implemented
+    AdapterClass & operator = ( const AdapterClass & ); // not implemented
+
+    ~AdapterClass();
+
+    bool isCurrent( const AdapterAttribute & attr ) const;
+
+public:
+    /** precondition: the global interpreter lock is held, the new class
+        has one reference
+     */
+    AdapterClass( const PyRef & type );
+
+    void acquire() { osl_incrementInterlockedCount( &mRefCount ); }
+    void release()
+    {
+        if( osl_decrementInterlockedCount( &mRefCount ) == 0 )
+            delete this;
+    }
+
+    /** whether only the runtime holds the class. New references are only
+        taken with the global interpreter lock held, so with the lock held
+        the result stays valid.
+     */
+    bool isUnused() const { return mRefCount == 1; }
+
+    PyObject *getType() const { return mType.get(); }
+
+    /** whether a current entry says that the class declares the attribute,
+        false when there is none. Needs no global interpreter lock.
+     */
+    bool isDeclared( const rtl::OUString & name );
+
+    /** precondition: the global interpreter lock is held
+     */
+    AdapterAttribute getAttribute( const rtl::OUString & name );
+};
+
+typedef ::std::hash_map
+<
+    PyRef,
+    AdapterClass *,
+    PyRef::Hash,
+    std::equal_to< PyRef >
+> AdapterClassMap;
+
+/** the classes of the exported objects of one runtime. A class no
+    adapter uses anymore is dropped by the next sweep, which runs when the
+    number of classes has doubled since the last one.
+ */
+struct AdapterClasses
+{
+    AdapterClassMap map;
+    size_t nSweepAt;
+
+    AdapterClasses() : nSweepAt( 64 ) {}
+};
+
+/** returns the shared class data of type, acquired for the caller */
+AdapterClass *getAdapterClass( const Runtime & runtime, PyObject *type );
+
+/** one entity of the TypeIndex. The layout is the one of the index file.
+ */
+struct TypeIndexEntry
+{
+    sal_uInt32 name;            // offset of the full utf-8 name in the string pool
+    sal_uInt32 nameLength;
+    sal_uInt32 hash;
+    sal_uInt32 nextInBucket;
+    sal_uInt32 firstChild;      // of modules, constants groups and enums
+    sal_uInt32 nextSibling;
+    sal_uInt16 typeClass;       // com::sun::star::uno::TypeClass
+    sal_uInt16 flags;           // TYPEINDEX_ flags
+    sal_uInt16 valueTypeClass;  // constants only
+    sal_uInt16 reserved;
+    sal_Int64 value;            // constants and enum values
+};
+
+static const sal_uInt32 TYPEINDEX_NO_ENTRY = 0xffffffff;
+static const sal_uInt16 TYPEINDEX_POLYMORPHIC_STRUCT = 0x1;
+static const sal_uInt16 TYPEINDEX_ENUM_VALUE = 0x2;
+
+/** index of the modules, constants groups, enums and their elements known to
+    the type description manager. It is kept as memory mapped file, so other
+    processes can use it without asking the type manager again.
+
+    The file is given by PYUNO_TYPEINDEX in the pyuno ini file, it is rebuilt
+    whenever one of the type libraries listed in UNO_TYPES has changed.
+    Names missing in the index must still be looked up at the type manager,
+    e.g. types of extensions.
+
+    implementation can be found in pyuno_typeindex.cxx
+ */
+class TypeIndex
+{
+    void *mpData;
+    sal_uInt64 mnSize;
+    bool mbMapped;
+    const sal_uInt32 *mpBuckets;
+    const TypeIndexEntry *mpEntries;
+    const sal_Char *mpStrings;
+    sal_uInt32 mnBuckets;
+    sal_uInt32 mnEntries;
+
+    TypeIndex( const TypeIndex & ); // not implemented
+    TypeIndex & operator = ( const TypeIndex & ); // not implemented
+
+    TypeIndex( void *pData, sal_uInt64 nSize, bool bMapped );
+    bool init( const ::std::vector< rtl::OString > & sources );
+
+public:
+    ~TypeIndex();
+
+    /** loads the index or builds it, when it is missing or outdated.
+        Returns 0, when no index can be used.
+     */
+    static TypeIndex *create( const Runtime & runtime );
+
+    const TypeIndexEntry *find( const sal_Char *name, sal_Int32 length ) const;
+    const TypeIndexEntry *getEntry( sal_uInt32 index ) const
+    { return index < mnEntries ? mpEntries + index : 0; }
+    const sal_Char *getName( const TypeIndexEntry *pEntry ) const
+    { return mpStrings + pEntry->name; }
+
+    /** the name without the name of the module */
+    rtl::OUString getSimpleName( const TypeIndexEntry *pEntry ) const;
+
+    /** the value of a constant */
+    com::sun::star::uno::Any getConstantValue( const TypeIndexEntry *pEntry ) const;
+};
+
+/** returns the type index of the runtime, which is created on first use,
+    or 0 if there is none
+ */
+TypeIndex *getTypeIndex( const Runtime & runtime );
+
+/** returns the url of the pyuno ini file next to the module */
+rtl::OUString getPyUnoIniFileName();
+
 struct RuntimeCargo
 {
     com::sun::star::uno::Reference< com::sun::star::lang::XSingleServiceFactory > xInvocation;
@@ -199,13 +537,17 @@ struct RuntimeCargo
     com::sun::star::uno::Reference< com::sun::star::beans::XIntrospection > xIntrospection;
     PyRef dictUnoModule;
     bool valid;
-    ExceptionClassMap exceptionMap;
-    ClassSet interfaceSet;
-    PyRef2Adapter mappedObjects;
+    ClassCache classCache;
+    WrapperMap wrappers;
+    AdapterClasses adapterClasses;
+    TypeIndex *typeIndex;
+    bool typeIndexChecked;
+    bool lazySequences;
     FILE *logFile;
     sal_Int32 logLevel;
 
     PyRef getUnoModule();
+    ~RuntimeCargo();
 };
 
 struct stRuntimeImpl
@@ -221,11 +563,64 @@ public:
 };
 
 
+class Adapter;
+
+/** identity map of the python objects exported to UNO, an open addressing
+    table keyed by the object pointer. The map holds no references, an adapter
+    removes its entry when it loses its last reference. The adapter keeps the
+    python object alive, so the key can't be reused while the entry exists.
+ */
+class AdapterMap
+{
+    struct Entry
+    {
+        PyObject *key;
+        Adapter *adapter;
+    };
+
+    Entry *mpEntries;
+    sal_uInt32 mnCapacity;  // always a power of two
+    sal_uInt32 mnUsed;      // live entries and removed ones
+    osl::Mutex mMutex;
+
+    AdapterMap( const AdapterMap & ); // not implemented
+    AdapterMap & operator = ( const AdapterMap & ); // not implemented
+
+    Entry *find( PyObject *key );
+    void rehash( sal_uInt32 capacity );
+
+public:
+    AdapterMap();
+    ~AdapterMap();
+
+    /** returns the acquired adapter of the python object or 0
+     */
+    Adapter *lookup( PyObject *object );
+
+    /** precondition: the adapter is acquired by the caller
+     */
+    void insert( PyObject *object, Adapter *adapter );
+
+    /** precondition: getMutex() is locked
+     */
+    void remove( PyObject *object, Adapter *adapter );
+
+    /** appends all living adapters, each acquired for the caller
+     */
+    void collect( std::vector< Adapter * > & adapters );
+
+    osl::Mutex & getMutex() { return mMutex; }
+};
+
+AdapterMap & getAdapterMap();
+
 class Adapter : public cppu::WeakImplHelper2<
     com::sun::star::script::XInvocation, com::sun::star::lang::XUnoTunnel >
 {
     PyRef mWrappedObject;
     PyInterpreterState *mInterpreter;  // interpreters don't seem to be refcounted !
+    AdapterClass *mpClass; // acquired
+    osl::Mutex mClassMutex; // guards mpClass for the reads without the global interpreter lock
     com::sun::star::uno::Sequence< com::sun::star::uno::Type > mTypes;
     MethodOutIndexMap m_methodOutIndexMap;
 
@@ -240,8 +635,25 @@ public:
     static com::sun::star::uno::Sequence< sal_Int8 > getUnoTunnelImplementationId();
     PyRef getWrappedObject() { return mWrappedObject; }
     com::sun::star::uno::Sequence< com::sun::star::uno::Type > getWrappedTypes() { return mTypes; }
+    PyInterpreterState *getInterpreter() const { return mInterpreter; }
+    /** returns the class data of the current class of the wrapped object,
+        which python code may have reassigned. precondition: the global
+        interpreter lock is held
+     */
+    AdapterClass *getClass();
+    /** the number of references UNO holds to the adapter */
+    sal_Int32 getRefCount() const { return m_refCount; }
+
+    /** returns the callable for the given method name or 0 with the python
+        error set. When nSelf is 1, the wrapped object must be passed as first
+        argument. precondition: the global interpreter lock is held
+     */
+    PyRef lookupMethod( const rtl::OUString & name, AdapterAttribute & attr, sal_Int32 & nSelf );
     virtual ~Adapter();
-    
+
+    // XInterface, the last release removes the adapter from the AdapterMap
+    virtual void SAL_CALL release() throw ();
+
     // XInvocation
     virtual com::sun::star::uno::Reference< ::com::sun::star::beans::XIntrospectionAccess >
            SAL_CALL getIntrospection(  ) throw (::com::sun::star::uno::RuntimeException);
@@ -278,6 +690,15 @@ public:
 };
 
 
+/** creates the binary UNO object for the given adapter, which dispatches the
+    typed calls of its interfaces directly to the wrapped python object.
+    Adapters already exported to UNO get the same object again.
+
+    implementation can be found in pyuno_binary.cxx
+ */
+com::sun::star::uno::Reference< com::sun::star::uno::XInterface > createBinaryAdapter(
+    Adapter *pAdapter );
+
 /** releases a refcount on the interpreter object and on another given python object.
 
    The function can be called from any thread regardless of whether the global
@@ -286,6 +707,11 @@ public:
  */
 void decreaseRefCount( PyInterpreterState *interpreter, PyObject *object );
 
+/** releases the python objects queued by decreaseRefCount(), which belong to
+    the current interpreter. precondition: the global interpreter lock is held
+ */
+void releasePendingPyObjects();
+
 }
 
 #endif
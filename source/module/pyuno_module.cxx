@@ -38,8 +38,9 @@
 #include <cppuhelper/bootstrap.hxx>
 
 #include <com/sun/star/reflection/XIdlReflection.hpp>
-#include <com/sun/star/reflection/XIdlClass.hpp>
 #include <com/sun/star/registry/InvalidRegistryException.hpp>
+#include <com/sun/star/beans/PropertyValue.hpp>
+#include <com/sun/star/beans/NamedValue.hpp>
 #if PY_VERSION_HEX > 0x03010000
 #include <com/sun/star/reflection/XTypeDescription.hpp>
 #include <com/sun/star/reflection/XEnumTypeDescription.hpp>
@@ -53,6 +54,7 @@ using osl::Module;
 using rtl::OString;
 using rtl::OUString;
 using rtl::OUStringToOString;
+using rtl::OStringToOUString;
 using rtl::OUStringBuffer;
 using rtl::OStringBuffer;
 
@@ -67,8 +69,8 @@ using com::sun::star::uno::TypeDescription;
 using com::sun::star::uno::XComponentContext;
 using com::sun::star::container::NoSuchElementException;
 using com::sun::star::reflection::XIdlReflection;
-using com::sun::star::reflection::XIdlClass;
-using com::sun::star::script::XInvocation2;
+using com::sun::star::beans::PropertyValue;
+using com::sun::star::beans::NamedValue;
 #if PY_VERSION_HEX > 0x03010000
 using com::sun::star::reflection::XTypeDescription;
 using com::sun::star::reflection::XEnumTypeDescription;
@@ -82,39 +84,6 @@ using namespace pyuno;
 
 namespace {
 
-/**
-   @ index of the next to be used member in the initializer list !
- */
-sal_Int32 fillStructWithInitializer(
-    const Reference< XInvocation2 > &inv,
-    typelib_CompoundTypeDescription *pCompType,
-    PyObject *initializer,
-    const Runtime &runtime) throw ( RuntimeException )
-{
-    sal_Int32 nIndex = 0;
-    if( pCompType->pBaseTypeDescription )
-        nIndex = fillStructWithInitializer(
-            inv, pCompType->pBaseTypeDescription, initializer, runtime );
-
-    sal_Int32 nTupleSize =  PyTuple_Size(initializer);
-    int i;
-    for( i = 0 ; i < pCompType->nMembers ; i ++ )
-    {
-        if( i + nIndex >= nTupleSize )
-        {
-            OUStringBuffer buf;
-            buf.appendAscii( "pyuno._createUnoStructHelper: too few elements in the initializer tuple,");
-            buf.appendAscii( "expected at least " ).append( nIndex + pCompType->nMembers );
-            buf.appendAscii( ", got " ).append( nTupleSize );
-            throw RuntimeException(buf.makeStringAndClear(), Reference< XInterface > ());
-        }
-        PyObject *element = PyTuple_GetItem( initializer, i + nIndex );
-        Any a = runtime.pyObject2Any( element, ACCEPT_UNO_ANY );
-        inv->setValue( pCompType->ppMemberNames[i], a );
-    }
-    return i+nIndex;
-}
-
 OUString getLibDir()
 {
     static OUString *pLibDir;
@@ -254,9 +223,8 @@ PyObject * extractOneStringArg( PyObject *args, char const *funcName )
     return obj;
 }
 
-static PyObject *createUnoStructHelper(PyObject *, PyObject* args )
+static PyObject *createUnoStructHelper(PyObject *, PyObject* args, PyObject *keywordArgs )
 {
-    Any IdlStruct;
     PyRef ret;
 
     try
@@ -275,40 +243,11 @@ static PyObject *createUnoStructHelper(PyObject *, PyObject* args )
             {
                 if( PyTuple_Check( initializer ) )
                 {
-#if PY_VERSION_HEX > 0x03000000
-                    OUString typeName( OUString::createFromAscii(PyUnicode_AsUTF8(structName)));
-#else
-                    OUString typeName( OUString::createFromAscii(PyString_AsString(structName)));
-#endif
-                    RuntimeCargo *c = runtime.getImpl()->cargo;
-                    Reference<XIdlClass> idl_class ( c->xCoreReflection->forName (typeName),UNO_QUERY);
-                    if (idl_class.is ())
+                    // the class constructs the value in place from its precompiled members
+                    PyRef clazz = getClass( pyString2ustring( structName ), runtime );
+                    if( ! isInterfaceClass( runtime, clazz.get() ) )
                     {
-                        idl_class->createObject (IdlStruct);
-                        PyUNO *me = (PyUNO*)PyUNO_new_UNCHECKED( IdlStruct, c->xInvocation );
-                        PyRef returnCandidate( (PyObject*)me, SAL_NO_ACQUIRE );
-                        if( PyTuple_Size( initializer ) > 0 )
-                        {
-                            TypeDescription desc( typeName );
-                            OSL_ASSERT( desc.is() ); // could already instantiate an XInvocation2 !
-
-                            typelib_CompoundTypeDescription *pCompType =
-                                ( typelib_CompoundTypeDescription * ) desc.get();
-                            sal_Int32 n = fillStructWithInitializer(
-                                me->members->xInvocation, pCompType, initializer, runtime );
-                            if( n != PyTuple_Size(initializer) )
-                            {
-                                OUStringBuffer buf;
-                                buf.appendAscii( "pyuno._createUnoStructHelper: wrong number of ");
-                                buf.appendAscii( "elements in the initializer list, expected " );
-                                buf.append( n );
-                                buf.appendAscii( ", got " );
-                                buf.append( (sal_Int32) PyTuple_Size(initializer) );
-                                throw RuntimeException(
-                                    buf.makeStringAndClear(), Reference< XInterface > ());
-                            }
-                        }
-                        ret = returnCandidate;
+                        ret = PyRef( PyObject_Call( clazz.get(), initializer, keywordArgs ), SAL_NO_ACQUIRE );
                     }
                     else
                     {
@@ -344,14 +283,6 @@ static PyObject *createUnoStructHelper(PyObject *, PyObject* args )
     {
         raisePyExceptionWithAny( makeAny( e ) );
     }
-    catch( com::sun::star::script::CannotConvertException & e )
-    {
-        raisePyExceptionWithAny( makeAny( e ) );
-    }
-    catch( com::sun::star::uno::Exception & e )
-    {
-        raisePyExceptionWithAny( makeAny( e ) );
-    }
     return ret.getAcquired();
 }
 
@@ -399,6 +330,11 @@ static PyObject *getConstantByName( PyObject *, PyObject *args )
         {
             OUString typeName ( OUString::createFromAscii( name ) );
             Runtime runtime;
+            TypeIndex *pIndex = getTypeIndex( runtime );
+            const TypeIndexEntry *pEntry = pIndex ? pIndex->find( name, strlen( name ) ) : 0;
+            if( pEntry && pEntry->typeClass == com::sun::star::uno::TypeClass_CONSTANT )
+                return runtime.any2PyObject( pIndex->getConstantValue( pEntry ) ).getAcquired();
+
             Any a = runtime.getImpl()->cargo->xTdMgr->getByHierarchicalName(typeName);
             if( a.getValueType().getTypeClass() ==
                 com::sun::star::uno::TypeClass_INTERFACE )
@@ -517,6 +453,14 @@ static PyObject *getClass( PyObject *, PyObject *args )
 }
 
 #if PY_VERSION_HEX > 0x3010000
+static bool isModuleEntry( const TypeIndexEntry *pEntry )
+{
+    return ( pEntry->flags & TYPEINDEX_ENUM_VALUE ) == 0 &&
+        ( pEntry->typeClass == com::sun::star::uno::TypeClass_MODULE ||
+          pEntry->typeClass == com::sun::star::uno::TypeClass_CONSTANTS ||
+          pEntry->typeClass == com::sun::star::uno::TypeClass_ENUM );
+}
+
 static PyObject *hasModule( PyObject *, PyObject *args )
 {
     PyObject *ret = 0;
@@ -527,6 +471,11 @@ static PyObject *hasModule( PyObject *, PyObject *args )
         {
             OUString typeName ( OUString::createFromAscii( name ) );
             Runtime runtime;
+            TypeIndex *pIndex = getTypeIndex( runtime );
+            const TypeIndexEntry *pEntry = pIndex ? pIndex->find( name, strlen( name ) ) : 0;
+            if( pEntry )
+                return PyLong_FromLong( isModuleEntry( pEntry ) );
+
             Any a = runtime.getImpl()->cargo->xTdMgr->getByHierarchicalName(typeName);
             Reference< com::sun::star::reflection::XTypeDescription > xTypeDescription(a, UNO_QUERY);
             if ( xTypeDescription.is() )
@@ -555,25 +504,6 @@ static PyObject *hasModule( PyObject *, PyObject *args )
 }
 
 
-static int isPolymorphicStruct( const Reference< XTypeDescription > &xTypeDescription )
-{
-    if ( xTypeDescription.is() && 
-         xTypeDescription->getTypeClass() == com::sun::star::uno::TypeClass_STRUCT )
-    {
-        Reference< XStructTypeDescription > xStructTypeDescription( xTypeDescription, UNO_QUERY );
-        if ( xStructTypeDescription.is() )
-        {
-            if ( xStructTypeDescription->getTypeParameters().getLength() )
-                return 1;
-            Reference< XTypeDescription > xBaseTypeDescription = xStructTypeDescription->getBaseType();
-            if ( xBaseTypeDescription.is() )
-                return isPolymorphicStruct( xBaseTypeDescription );
-        }
-    }
-    return 0;
-}
-
-
 static PyObject *getModuleElementNames( PyObject *, PyObject *args )
 {
     try
@@ -584,7 +514,30 @@ static PyObject *getModuleElementNames( PyObject *, PyObject *args )
             PyRef ret;
             OUString typeName ( OUString::createFromAscii( name ) );
             Runtime runtime;
-            
+
+            // extensions may add types to indexed modules, so only the closed
+            // sets of constants groups and enums are answered from the index
+            TypeIndex *pIndex = getTypeIndex( runtime );
+            const TypeIndexEntry *pModule = pIndex ? pIndex->find( name, strlen( name ) ) : 0;
+            if( pModule && isModuleEntry( pModule ) &&
+                pModule->typeClass != com::sun::star::uno::TypeClass_MODULE )
+            {
+                ::std::vector< const TypeIndexEntry * > elements;
+                for( const TypeIndexEntry *pEntry = pIndex->getEntry( pModule->firstChild );
+                     pEntry ; pEntry = pIndex->getEntry( pEntry->nextSibling ) )
+                {
+                    elements.push_back( pEntry );
+                }
+                ret = PyRef( PyTuple_New( elements.size() ), SAL_NO_ACQUIRE );
+                for( sal_uInt32 i = 0 ; i < elements.size() ; i ++ )
+                {
+                    PyTuple_SetItem(
+                        ret.get(), i,
+                        ustring2PyUnicode( pIndex->getSimpleName( elements[i] ) ).getAcquired() );
+                }
+                return ret.getAcquired();
+            }
+
             Any a = runtime.getImpl()->cargo->xTdMgr->getByHierarchicalName(typeName);
             Reference< XTypeDescription > xTypeDescription(a, UNO_QUERY);
             if ( xTypeDescription.is() )
@@ -681,6 +634,218 @@ static PyObject *getModuleElementNames( PyObject *, PyObject *args )
     }
     return 0;
 }
+
+static PyObject *makeResolved( const char *kind, const PyRef & value )
+{
+    if( ! value.is() )
+        return 0;
+    PyRef ret( PyTuple_New( 2 ), SAL_NO_ACQUIRE );
+    PyTuple_SetItem( ret.get(), 0, PyUnicode_FromString( kind ) );
+    PyTuple_SetItem( ret.get(), 1, value.getAcquired() );
+    return ret.getAcquired();
+}
+
+static bool isEnumValue( const OUString & enumName, const char *value )
+{
+    TypeDescription desc( enumName );
+    if( ! desc.is() || desc.get()->eTypeClass != typelib_TypeClass_ENUM )
+        return false;
+    desc.makeComplete();
+    typelib_EnumTypeDescription *pEnumDesc = (typelib_EnumTypeDescription*) desc.get();
+    for( sal_Int32 i = 0 ; i < pEnumDesc->nEnumValues ; i ++ )
+    {
+        if( (*((OUString *)&pEnumDesc->ppEnumNames[i])).equalsAscii( value ) )
+            return true;
+    }
+    return false;
+}
+
+/** Returns all values of a constants group or an enum as a dict in one pass,
+    or None if the name denotes neither.
+*/
+static PyObject *getModuleValues( PyObject *, PyObject *args )
+{
+    char *name;
+    if( ! PyArg_ParseTuple( args, const_cast< char * >("s"), &name ) )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        OUString typeName( OUString::createFromAscii( name ) );
+        PyRef ret( PyDict_New(), SAL_NO_ACQUIRE );
+
+        TypeIndex *pIndex = getTypeIndex( runtime );
+        const TypeIndexEntry *pModule = pIndex ? pIndex->find( name, strlen( name ) ) : 0;
+        // enums are built from their type description below, which yields
+        // the values together with their indices
+        if( pModule && pModule->typeClass != com::sun::star::uno::TypeClass_ENUM )
+        {
+            if( ( pModule->flags & TYPEINDEX_ENUM_VALUE ) ||
+                pModule->typeClass != com::sun::star::uno::TypeClass_CONSTANTS )
+            {
+                Py_INCREF( Py_None );
+                return Py_None;
+            }
+            for( const TypeIndexEntry *pEntry = pIndex->getEntry( pModule->firstChild );
+                 pEntry ; pEntry = pIndex->getEntry( pEntry->nextSibling ) )
+            {
+                OUString simpleName( pIndex->getSimpleName( pEntry ) );
+                PyRef value( runtime.any2PyObject( pIndex->getConstantValue( pEntry ) ) );
+                if( ! value.is() ||
+                    PyDict_SetItem( ret.get(), ustring2PyInternedString( simpleName ).get(), value.get() ) < 0 )
+                    return 0;
+            }
+            return ret.getAcquired();
+        }
+
+        TypeDescription desc( typeName );
+        if( desc.is() && desc.get()->eTypeClass == typelib_TypeClass_ENUM )
+        {
+            desc.makeComplete();
+            typelib_EnumTypeDescription *pEnumDesc = (typelib_EnumTypeDescription*) desc.get();
+            for( sal_Int32 i = 0 ; i < pEnumDesc->nEnumValues ; i ++ )
+            {
+                const OUString & simpleName = *((OUString *)&pEnumDesc->ppEnumNames[i]);
+                PyRef value( PyUNO_Enum_fromIndex( pEnumDesc, i ), SAL_NO_ACQUIRE );
+                if( ! value.is() ||
+                    PyDict_SetItem( ret.get(), ustring2PyInternedString( simpleName ).get(), value.get() ) < 0 )
+                    return 0;
+            }
+            return ret.getAcquired();
+        }
+
+        Reference< XConstantsTypeDescription > xConstants(
+            runtime.getImpl()->cargo->xTdMgr->getByHierarchicalName( typeName ), UNO_QUERY );
+        if( ! xConstants.is() )
+        {
+            Py_INCREF( Py_None );
+            return Py_None;
+        }
+        Sequence< Reference< XConstantTypeDescription > > aConstants = xConstants->getConstants();
+        const sal_Int32 nLength = typeName.getLength() + 1;
+        for( sal_Int32 i = 0 ; i < aConstants.getLength() ; i ++ )
+        {
+            PyRef value = runtime.any2PyObject( aConstants[i]->getConstantValue() );
+            if( PyDict_SetItem(
+                    ret.get(), ustring2PyInternedString( aConstants[i]->getName().copy( nLength ) ).get(),
+                    value.get() ) < 0 )
+                return 0;
+        }
+        return ret.getAcquired();
+    }
+    catch( NoSuchElementException & )
+    {
+        Py_INCREF( Py_None );
+        return Py_None;
+    }
+    catch( com::sun::star::lang::IllegalArgumentException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( com::sun::star::script::CannotConvertException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+/** Resolves the element name of the module in one step.
+
+    Returns a tuple ( kind, value ) where kind is one of "class", "enum",
+    "constant" or "type", or None if the module has no such element.
+*/
+static PyObject *resolve( PyObject *, PyObject *args )
+{
+    char *module;
+    char *name;
+    if( ! PyArg_ParseTuple( args, const_cast< char * >("ss"), &module, &name ) )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        OString fullName( OStringBuffer().append( module ).append( '.' ).append( name ).makeStringAndClear() );
+        OUString typeName( OStringToOUString( fullName, RTL_TEXTENCODING_UTF8 ) );
+
+        TypeIndex *pIndex = getTypeIndex( runtime );
+        const TypeIndexEntry *pEntry =
+            pIndex ? pIndex->find( fullName.getStr(), fullName.getLength() ) : 0;
+        if( pEntry )
+        {
+            if( pEntry->flags & TYPEINDEX_ENUM_VALUE )
+                return makeResolved( "enum", PyRef( PyUNO_Enum_new( module, name, runtime ), SAL_NO_ACQUIRE ) );
+            switch( pEntry->typeClass )
+            {
+            case com::sun::star::uno::TypeClass_STRUCT:
+                if( pEntry->flags & TYPEINDEX_POLYMORPHIC_STRUCT )
+                    break;
+                // fall through
+            case com::sun::star::uno::TypeClass_EXCEPTION:
+            case com::sun::star::uno::TypeClass_INTERFACE:
+                return makeResolved( "class", getClass( typeName, runtime ) );
+            case com::sun::star::uno::TypeClass_CONSTANT:
+                return makeResolved( "constant", runtime.any2PyObject( pIndex->getConstantValue( pEntry ) ) );
+            default:
+                break;
+            }
+            Py_INCREF( Py_None );
+            return Py_None;
+        }
+
+        Any a;
+        try
+        {
+            a = runtime.getImpl()->cargo->xTdMgr->getByHierarchicalName( typeName );
+        }
+        catch( NoSuchElementException & )
+        {
+        }
+        if( a.getValueType().getTypeClass() == com::sun::star::uno::TypeClass_INTERFACE )
+        {
+            Reference< XTypeDescription > xTypeDescription( a, UNO_QUERY );
+            if( xTypeDescription.is() )
+            {
+                com::sun::star::uno::TypeClass typeClass = xTypeDescription->getTypeClass();
+                if( ( typeClass == com::sun::star::uno::TypeClass_STRUCT &&
+                      ! isPolymorphicStruct( xTypeDescription ) ) ||
+                    typeClass == com::sun::star::uno::TypeClass_EXCEPTION ||
+                    typeClass == com::sun::star::uno::TypeClass_INTERFACE )
+                    return makeResolved( "class", getClass( typeName, runtime ) );
+            }
+        }
+        else if( a.hasValue() )
+            return makeResolved( "constant", runtime.any2PyObject( a ) );
+        else if( isEnumValue( OUString::createFromAscii( module ), name ) )
+            return makeResolved( "enum", PyRef( PyUNO_Enum_new( module, name, runtime ), SAL_NO_ACQUIRE ) );
+        else if( strncmp( name, "typeOf", 6 ) == 0 && name[6] )
+        {
+            OString typeOfName( OStringBuffer().append( module ).append( '.' ).append( name + 6 ).makeStringAndClear() );
+            TypeDescription desc( OStringToOUString( typeOfName, RTL_TEXTENCODING_UTF8 ) );
+            if( desc.is() )
+                return makeResolved( "type", PyRef( PyUNO_Type_new(
+                    typeOfName.getStr(), (com::sun::star::uno::TypeClass)desc.get()->eTypeClass, runtime ),
+                    SAL_NO_ACQUIRE ) );
+        }
+        Py_INCREF( Py_None );
+        return Py_None;
+    }
+    catch( com::sun::star::lang::IllegalArgumentException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( com::sun::star::script::CannotConvertException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
 #endif
 
 static PyObject *isInterface( PyObject *, PyObject *args )
@@ -854,6 +1019,195 @@ static PyObject * invoke ( PyObject *, PyObject * args )
     return ret;
 }
 
+template< class T >
+static void namedValues2Dict( const Runtime & runtime, PyObject *dict, const T *pValues, sal_Int32 nValues )
+{
+    for( sal_Int32 i = 0 ; i < nValues ; i ++ )
+    {
+        PyDict_SetItem( dict, ustring2PyUnicode( pValues[i].Name ).get(),
+                        runtime.any2PyObject( pValues[i].Value ).get() );
+    }
+}
+
+/** Returns a list of ( object, references ) for every python object exported
+    to UNO, references being the number of UNO references to its adapter.
+    The adapter's reference to the object is invisible to the cycle collector,
+    so cycles through UNO can only be found with this information.
+*/
+static PyObject *getExportedObjects( PyObject *, PyObject * )
+{
+    std::vector< Adapter * > adapters;
+    getAdapterMap().collect( adapters );
+    PyRef ret( PyList_New( adapters.size() ), SAL_NO_ACQUIRE );
+    for( size_t i = 0 ; i < adapters.size() ; i ++ )
+    {
+        Adapter *pAdapter = adapters[i];
+        // without the reference acquired by collect()
+        PyObject *entry = ret.is() ? Py_BuildValue(
+            const_cast< char * >("(Oi)"), pAdapter->getWrappedObject().get(),
+            (int) pAdapter->getRefCount() - 1 ) : 0;
+        pAdapter->release();
+        if( ! entry )
+            ret.clear();
+        else
+            PyList_SET_ITEM( ret.get(), i, entry );
+    }
+    return ret.getAcquired();
+}
+
+/** Returns a dict of the names and values of a sequence of PropertyValue
+    or NamedValue, the inverse of passing a dict as such a sequence.
+*/
+static PyObject *propertiesToDict( PyObject *, PyObject *args )
+{
+    PyObject *values = 0;
+    if( ! PyArg_ParseTuple( args, const_cast< char * >( "O" ), &values ) )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        Any a = runtime.pyObject2Any( values );
+        PyRef dict( PyDict_New(), SAL_NO_ACQUIRE );
+        Sequence< PropertyValue > props;
+        Sequence< NamedValue > namedValues;
+        Sequence< Any > elements;
+        if( a >>= props )
+            namedValues2Dict( runtime, dict.get(), props.getConstArray(), props.getLength() );
+        else if( a >>= namedValues )
+            namedValues2Dict( runtime, dict.get(), namedValues.getConstArray(), namedValues.getLength() );
+        else if( a >>= elements )
+        {
+            for( sal_Int32 i = 0 ; i < elements.getLength() ; i ++ )
+            {
+                PropertyValue prop;
+                NamedValue namedValue;
+                if( elements[i] >>= prop )
+                    namedValues2Dict( runtime, dict.get(), &prop, 1 );
+                else if( elements[i] >>= namedValue )
+                    namedValues2Dict( runtime, dict.get(), &namedValue, 1 );
+                else
+                    throw RuntimeException(
+                        OUString( RTL_CONSTASCII_USTRINGPARAM(
+                                      "uno.propertiesToDict expects PropertyValue or NamedValue elements" ) ),
+                        Reference< XInterface > () );
+            }
+        }
+        else
+            throw RuntimeException(
+                OUString( RTL_CONSTASCII_USTRINGPARAM(
+                              "uno.propertiesToDict expects a sequence of PropertyValue or NamedValue" ) ),
+                Reference< XInterface > () );
+        return dict.getAcquired();
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+/** Switches any2PyObject between tuples and lazy sequence views for
+    sequences, returns the previous setting.
+*/
+static PyObject *setLazySequences( PyObject *, PyObject *args )
+{
+    PyObject *flag = 0;
+    if( ! PyArg_ParseTuple( args, const_cast< char * >( "O" ), &flag ) )
+        return 0;
+    int enabled = PyObject_IsTrue( flag );
+    if( enabled < 0 )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        RuntimeCargo *cargo = runtime.getImpl()->cargo;
+        PyObject *ret = cargo->lazySequences ? Py_True : Py_False;
+        cargo->lazySequences = enabled != 0;
+        Py_INCREF( ret );
+        return ret;
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+/** Bounds the number of generated classes kept by the runtime, 0 for no
+    limit, returns the previous limit.
+*/
+static PyObject *setClassCacheLimit( PyObject *, PyObject *args )
+{
+    int limit = 0;
+    if( ! PyArg_ParseTuple( args, const_cast< char * >( "i" ), &limit ) )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        return PyLong_FromLong( runtime.getImpl()->cargo->classCache.setLimit( limit ) );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+/** Returns a dict with the number of cached classes, the number of dropped
+    ones still alive, the limit and the approximate memory of the cached ones.
+*/
+static PyObject *getClassCacheInfo( PyObject *, PyObject * )
+{
+    try
+    {
+        Runtime runtime;
+        ClassCache & cache = runtime.getImpl()->cargo->classCache;
+        return Py_BuildValue(
+            const_cast< char * >( "{s:i,s:i,s:i,s:L}" ),
+            "classes", (int) cache.getCount(),
+            "dropped", (int) cache.getDroppedCount(),
+            "limit", (int) cache.getLimit(),
+            "memory", (PY_LONG_LONG) cache.getMemory() );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+/** Creates the classes of the given struct, exception and interface names
+    in advance, e.g. before forking workers.
+*/
+static PyObject *preloadClasses( PyObject *, PyObject *args )
+{
+    PyObject *names = 0;
+    if( ! PyArg_ParseTuple( args, const_cast< char * >( "O" ), &names ) )
+        return 0;
+    PyRef iterator( PyObject_GetIter( names ), SAL_NO_ACQUIRE );
+    if( ! iterator.is() )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        for( PyRef name( PyIter_Next( iterator.get() ), SAL_NO_ACQUIRE ) ; name.is() ;
+             name = PyRef( PyIter_Next( iterator.get() ), SAL_NO_ACQUIRE ) )
+        {
+            if( ! getClass( pyString2ustring( name.get() ), runtime ).is() )
+                return 0;
+        }
+        if( PyErr_Occurred() )
+            return 0;
+        Py_INCREF( Py_None );
+        return Py_None;
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
 static PyObject *getCurrentContext( PyObject *, PyObject * )
 {
     PyRef ret;
@@ -919,7 +1273,7 @@ static PyObject *setCurrentContext( PyObject *, PyObject * args )
 struct PyMethodDef PyUNOModule_methods [] =
 {
     {const_cast< char * >("getComponentContext"), getComponentContext, METH_NOARGS, NULL}, 
-    {const_cast< char * >("_createUnoStructHelper"), createUnoStructHelper, METH_VARARGS, NULL},
+    {const_cast< char * >("_createUnoStructHelper"), (PyCFunction) createUnoStructHelper, METH_VARARGS | METH_KEYWORDS, NULL},
     {const_cast< char * >("getTypeByName"), getTypeByName, METH_VARARGS, NULL},
     {const_cast< char * >("getConstantByName"), getConstantByName, METH_VARARGS, NULL},
     {const_cast< char * >("getClass"), getClass, METH_VARARGS, NULL},
@@ -935,6 +1289,14 @@ struct PyMethodDef PyUNOModule_methods [] =
     {const_cast< char * >("getCurrentContext"), getCurrentContext, METH_VARARGS, NULL},
     {const_cast< char * >("hasModule"), hasModule, METH_VARARGS, NULL},
     {const_cast< char * >("getModuleElementNames"), getModuleElementNames, METH_VARARGS, NULL},
+    {const_cast< char * >("resolve"), resolve, METH_VARARGS, NULL},
+    {const_cast< char * >("getModuleValues"), getModuleValues, METH_VARARGS, NULL},
+    {const_cast< char * >("setLazySequences"), setLazySequences, METH_VARARGS, NULL},
+    {const_cast< char * >("propertiesToDict"), propertiesToDict, METH_VARARGS, NULL},
+    {const_cast< char * >("getExportedObjects"), getExportedObjects, METH_NOARGS, NULL},
+    {const_cast< char * >("setClassCacheLimit"), setClassCacheLimit, METH_VARARGS, NULL},
+    {const_cast< char * >("getClassCacheInfo"), getClassCacheInfo, METH_NOARGS, NULL},
+    {const_cast< char * >("preloadClasses"), preloadClasses, METH_VARARGS, NULL},
     {NULL, NULL, 0, NULL}
 };
 
@@ -950,7 +1312,7 @@ static struct PyModuleDef PyUNOModule =
 struct PyMethodDef PyUNOModule_methods [] =
 {
     {const_cast< char * >("getComponentContext"), getComponentContext, 1, NULL}, 
-    {const_cast< char * >("_createUnoStructHelper"), createUnoStructHelper, 2, NULL},
+    {const_cast< char * >("_createUnoStructHelper"), (PyCFunction) createUnoStructHelper, METH_VARARGS | METH_KEYWORDS, NULL},
     {const_cast< char * >("getTypeByName"), getTypeByName, 1, NULL},
     {const_cast< char * >("getConstantByName"), getConstantByName,1, NULL},
     {const_cast< char * >("getClass"), getClass,1, NULL},
@@ -982,6 +1344,10 @@ extern "C" PyMODINIT_FUNC PyInit_pyuno(void)
     
     if (PyType_Ready((PyTypeObject *)getPyUnoClass().get()))
         return NULL;
+    if (PyModule_AddObject(m, "PyUNO", getPyUnoClass().getAcquired()) < 0)
+        return NULL;
+    if (!initStructTypes(m) || !initSequenceType(m) || !initValueTypes(m))
+        return NULL;
     return m;
 }
 #else
@@ -989,7 +1355,10 @@ extern "C" PY_DLLEXPORT void initpyuno()
 {
     // noop when called already, otherwise needed to allow multiple threads
     PyEval_InitThreads();
-    Py_InitModule (const_cast< char * >("pyuno"), PyUNOModule_methods);
+    PyObject *m = Py_InitModule (const_cast< char * >("pyuno"), PyUNOModule_methods);
+    initStructTypes( m );
+    initSequenceType( m );
+    initValueTypes( m );
 }
 #endif
 
@@ -34,6 +34,8 @@
 #include <typelib/typedescription.hxx>
 
 #include <com/sun/star/beans/XMaterialHolder.hpp>
+#include <com/sun/star/beans/PropertyValue.hpp>
+#include <com/sun/star/beans/NamedValue.hpp>
 
 using rtl::OUString;
 using rtl::OUStringToOString;
@@ -57,6 +59,8 @@ using com::sun::star::script::XTypeConverter;
 using com::sun::star::script::XInvocationAdapterFactory2;
 using com::sun::star::script::XInvocation;
 using com::sun::star::beans::XMaterialHolder;
+using com::sun::star::beans::PropertyValue;
+using com::sun::star::beans::NamedValue;
 using com::sun::star::beans::XIntrospection;
 
 namespace pyuno
@@ -179,17 +183,22 @@ static PyRef importUnoModule( ) throw ( RuntimeException )
     return dict;
 }
 
-static void readLoggingConfig( sal_Int32 *pLevel, FILE **ppFile )
+OUString getPyUnoIniFileName()
 {
-    *pLevel = LogLevel::NONE;
-    *ppFile = 0;
     OUString fileName;
     osl_getModuleURLFromFunctionAddress(
-        reinterpret_cast< oslGenericFunction >(readLoggingConfig),
+        reinterpret_cast< oslGenericFunction >(getPyUnoIniFileName),
         (rtl_uString **) &fileName );
     fileName = OUString( fileName.getStr(), fileName.lastIndexOf( '/' )+1 );
     fileName += OUString::createFromAscii(  SAL_CONFIGFILE("pyuno") );
-    rtl::Bootstrap bootstrapHandle( fileName );
+    return fileName;
+}
+
+static void readLoggingConfig( sal_Int32 *pLevel, FILE **ppFile )
+{
+    *pLevel = LogLevel::NONE;
+    *ppFile = 0;
+    rtl::Bootstrap bootstrapHandle( getPyUnoIniFileName() );
 
     OUString str;
     if( bootstrapHandle.getFrom( USTR_ASCII( "PYUNO_LOGLEVEL" ), str ) )
@@ -500,11 +509,7 @@ PyRef Runtime::any2PyObject (const Any &a ) const
 	{
         Type t;
         a >>= t;
-        OString o = OUStringToOString( t.getTypeName(), RTL_TEXTENCODING_ASCII_US );
-        return PyRef(
-            PyUNO_Type_new (
-                o.getStr(),  (com::sun::star::uno::TypeClass)t.getTypeClass(), *this),
-            SAL_NO_ACQUIRE);
+        return PyRef( PyUNO_Type_fromRef( t.getTypeLibType() ), SAL_NO_ACQUIRE );
 	}
     case typelib_TypeClass_ANY:
 	{
@@ -514,64 +519,13 @@ PyRef Runtime::any2PyObject (const Any &a ) const
 	}
     case typelib_TypeClass_ENUM:
 	{
-        sal_Int32 l = *(sal_Int32 *) a.getValue();
-        TypeDescription desc( a.getValueType() );
-        if( desc.is() )
-        {
-            desc.makeComplete();
-            typelib_EnumTypeDescription *pEnumDesc =
-                (typelib_EnumTypeDescription *) desc.get();
-            for( int i = 0 ; i < pEnumDesc->nEnumValues ; i ++ )
-            {
-                if( pEnumDesc->pEnumValues[i] == l )
-                {
-                    OString v = OUStringToOString( pEnumDesc->ppEnumNames[i], RTL_TEXTENCODING_ASCII_US);
-                    OString e = OUStringToOString( pEnumDesc->aBase.pTypeName, RTL_TEXTENCODING_ASCII_US);
-                    return PyRef( PyUNO_Enum_new(e.getStr(),v.getStr(), *this ), SAL_NO_ACQUIRE );
-                }
-            }
-        }
-        OUStringBuffer buf;
-        buf.appendAscii( "Any carries enum " );
-        buf.append( a.getValueType().getTypeName());
-        buf.appendAscii( " with invalid value " ).append( l );
-        throw RuntimeException( buf.makeStringAndClear() , Reference< XInterface > ()  );
+        return PyRef( PyUNO_Enum_fromValue( a.getValueTypeRef(), *(sal_Int32 *) a.getValue() ),
+                      SAL_NO_ACQUIRE );
 	}
     case typelib_TypeClass_EXCEPTION:
     case typelib_TypeClass_STRUCT:
     {
-        PyRef excClass = getClass( a.getValueType().getTypeName(), *this );
-        PyRef value = PyRef( PyUNO_new_UNCHECKED (a, getImpl()->cargo->xInvocation), SAL_NO_ACQUIRE);
-        PyRef argsTuple( PyTuple_New( 1 ) , SAL_NO_ACQUIRE );
-        PyTuple_SetItem( argsTuple.get() , 0 , value.getAcquired() );
-        PyRef ret( PyObject_CallObject( excClass.get() , argsTuple.get() ), SAL_NO_ACQUIRE );
-        if( ! ret.is() )
-        {
-            OUStringBuffer buf;
-            buf.appendAscii( "Couldn't instantiate python representation of structered UNO type " );
-            buf.append( a.getValueType().getTypeName() );
-            throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () );
-        }
-
-        if( com::sun::star::uno::TypeClass_EXCEPTION == a.getValueTypeClass() )
-        {
-            // add the message in a standard python way !
-            PyRef args( PyTuple_New( 1 ), SAL_NO_ACQUIRE );
-            
-            // assuming that the Message is always the first member, wuuuu
-            void *pData = (void*)a.getValue();
-            OUString message = *(OUString * )pData;
-#if PY_VERSION_HEX > 0x03000000
-            PyRef pymsg = ustring2PyUnicode( message );
-#else
-            PyRef pymsg = ustring2PyString( message );
-#endif
-            PyTuple_SetItem( args.get(), 0 , pymsg.getAcquired() );
-            // the exception base functions want to have an "args" tuple,
-            // which contains the message
-            PyObject_SetAttrString( ret.get(), const_cast< char * >("args"), args.get() );
-        }
-        return ret;
+        return PyUNOStruct_new( a, *this );
     }
     case typelib_TypeClass_SEQUENCE:
 	{
@@ -584,6 +538,10 @@ PyRef Runtime::any2PyObject (const Any &a ) const
             // @since 0.9.2
             return PyRef( PyUNO_ByteSequence_new( byteSequence, *this ), SAL_NO_ACQUIRE );
         }
+        else if( getImpl()->cargo->lazySequences )
+        {
+            return PyUNOSequence_new( a, *this );
+        }
         else
         {
             Reference< XTypeConverter > tc = getImpl()->cargo->xTypeConverter;
@@ -625,7 +583,7 @@ PyRef Runtime::any2PyObject (const Any &a ) const
                 return ((Adapter*)sal::static_int_cast< sal_IntPtr >(that))->getWrappedObject();
         }
         //This is just like the struct case:
-        return PyRef( PyUNO_new (a, getImpl()->cargo->xInvocation), SAL_NO_ACQUIRE );
+        return PyRef( PyUNO_new( a, *this ), SAL_NO_ACQUIRE );
 	}
     default:
 	{
@@ -667,6 +625,140 @@ static Sequence< Type > invokeGetTypes( const Runtime & r , PyObject * o )
     return ret;
 }
 
+/** throws the pending python error as RuntimeException */
+static void throwPythonError( const Runtime & r )
+{
+    PyRef excType, excValue, excTraceback;
+    PyErr_Fetch( (PyObject **)&excType, (PyObject**)&excValue,(PyObject**)&excTraceback);
+    Any unoExc( r.extractUnoException( excType, excValue, excTraceback ) );
+    throw RuntimeException(
+        ((com::sun::star::uno::Exception*)unoExc.getValue())->Message,
+        Reference< XInterface > () );
+}
+
+/** the largest length hint trusted for the first allocation, a wrong or
+    huge hint must not allocate elements that never come
+*/
+static const Py_ssize_t ITERABLE_MAX_HINT = 4096;
+
+/** converts the items of an iterator over o in one pass, the sequence is
+    allocated from the bounded length hint of o and grows geometrically
+    beyond it
+*/
+static Sequence< Any > iterable2Sequence(
+    const Runtime & r, PyObject *o, const PyRef & iterator, enum ConversionMode mode )
+{
+#if PY_VERSION_HEX >= 0x03040000
+    Py_ssize_t hint = PyObject_LengthHint( o, 16 );
+#else
+    Py_ssize_t hint = _PyObject_LengthHint( o, 16 );
+#endif
+    if( hint < 0 )
+    {
+        PyErr_Clear();
+        hint = 16;
+    }
+    if( hint > ITERABLE_MAX_HINT )
+        hint = ITERABLE_MAX_HINT;
+    Sequence< Any > s( (sal_Int32) hint );
+    sal_Int32 n = 0;
+    for( ;; )
+    {
+        PyRef item( PyIter_Next( iterator.get() ), SAL_NO_ACQUIRE );
+        if( ! item.is() )
+            break;
+        if( n == s.getLength() )
+        {
+            if( n == SAL_MAX_INT32 )
+                throw RuntimeException(
+                    OUString( RTL_CONSTASCII_USTRINGPARAM( "too many elements for a UNO sequence" ) ),
+                    Reference< XInterface > () );
+            s.realloc( n > SAL_MAX_INT32 / 2 ? SAL_MAX_INT32 : ( n ? n * 2 : 16 ) );
+        }
+        s[n] = r.pyObject2Any( item, mode );
+        n ++;
+    }
+    if( PyErr_Occurred() )
+        throwPythonError( r );
+    if( n < s.getLength() )
+        s.realloc( n );
+    return s;
+}
+
+/** lists and tuples are converted directly, of the other iterables only
+    ranges, generators and collections.abc.Sequence instances, so that
+    arbitrary iterable objects don't turn into sequences by accident
+*/
+static bool isSequence( const Runtime & r, PyObject *o )
+{
+#if PY_VERSION_HEX >= 0x03000000
+    if( PyRange_Check( o ) || PyGen_Check( o ) )
+#else
+    if( PyGen_Check( o ) )
+#endif
+        return true;
+    PyRef abc( getSequenceABC( r ) );
+    if( ! abc.is() )
+        return false;
+    int ret = PyObject_IsInstance( o, abc.get() );
+    if( ret < 0 )
+        PyErr_Clear();
+    return ret > 0;
+}
+
+bool isMapping( const Runtime & r, PyObject *o )
+{
+    if( PyDict_Check( o ) )
+        return true;
+    PyRef abc( getMappingABC( r ) );
+    if( ! abc.is() )
+        return false;
+    int ret = PyObject_IsInstance( o, abc.get() );
+    if( ret < 0 )
+        PyErr_Clear();
+    return ret > 0;
+}
+
+template< class T >
+static Any items2Sequence( const Runtime & r, PyObject *items, enum ConversionMode mode )
+{
+    Sequence< T > s( PySequence_Fast_GET_SIZE( items ) );
+    T *pElements = s.getArray();
+    for( sal_Int32 i = 0 ; i < s.getLength() ; i ++ )
+    {
+        PyObject *item = PySequence_Fast_GET_ITEM( items, i );
+        if( ! PyTuple_Check( item ) || PyTuple_GET_SIZE( item ) != 2 )
+            throw RuntimeException(
+                OUString( RTL_CONSTASCII_USTRINGPARAM( "mapping items must be (name, value) pairs" ) ),
+                Reference< XInterface > () );
+        PyObject *key = PyTuple_GET_ITEM( item, 0 );
+#if PY_VERSION_HEX < 0x03000000
+        if( ! PyUnicode_Check( key ) && ! PyString_Check( key ) )
+#else
+        if( ! PyUnicode_Check( key ) )
+#endif
+            throw RuntimeException(
+                OUString( RTL_CONSTASCII_USTRINGPARAM( "names of named values must be strings" ) ),
+                Reference< XInterface > () );
+        pElements[i].Name = pyString2ustring( key );
+        pElements[i].Value = r.pyObject2Any( PyTuple_GET_ITEM( item, 1 ), mode );
+    }
+    return com::sun::star::uno::makeAny( s );
+}
+
+Any mapping2NamedValues(
+    const Runtime & r, PyObject *mapping, bool bNamedValue, enum ConversionMode mode )
+{
+    PyRef items( PyMapping_Items( mapping ), SAL_NO_ACQUIRE );
+    if( items.is() )
+        items = PyRef( PySequence_Fast( items.get(), "items() must return a sequence" ), SAL_NO_ACQUIRE );
+    if( ! items.is() )
+        throwPythonError( r );
+    return bNamedValue
+        ? items2Sequence< NamedValue >( r, items.get(), mode )
+        : items2Sequence< PropertyValue >( r, items.get(), mode );
+}
+
 Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) const
     throw ( com::sun::star::uno::RuntimeException )
 {
@@ -751,20 +843,39 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
 #endif
     else if( PyUnicode_Check( o ) )
 	a <<= pyString2ustring(o);
-    else if (PyTuple_Check (o))
+    else if( PyTuple_Check( o ) || PyList_Check( o ) )
     {
-        Sequence<Any> s (PyTuple_Size (o));
-        for (int i = 0; i < PyTuple_Size (o); i++)
+        Sequence< Any > s( PySequence_Fast_GET_SIZE( o ) );
+        Any *pElements = s.getArray();
+        sal_Int32 i = 0;
+        // a list may shrink while its elements are converted
+        for( ; i < s.getLength() && i < PySequence_Fast_GET_SIZE( o ) ; i ++ )
         {
-            s[i] = pyObject2Any (PyTuple_GetItem (o, i), mode );
+            pElements[i] = pyObject2Any( PySequence_Fast_GET_ITEM( o, i ), mode );
         }
+        if( i < s.getLength() )
+            s.realloc( i );
         a <<= s;
     }
+    else if( PyDict_Check( o ) )
+    {
+        a = mapping2NamedValues( *this, o, false, mode );
+    }
     else
     {
         Runtime runtime;
+        PyUNOStructData *pStruct = getStructData( o );
+        if( pStruct )
+        {
+            a = Any( pStruct->pData, pStruct->pTypeDescr );
+        }
+        else if( PyUNOSequence_Check( o ) )
+        {
+            // the view still holds the original sequence
+            a = PyUNOSequence_getValue( o );
+        }
         // should be removed, in case ByteSequence gets derived from String 
-        if( PyObject_IsInstance( o, getByteSequenceClass( runtime ).get() ) )
+        else if( PyObject_IsInstance( o, getByteSequenceClass( runtime ).get() ) )
         {
             PyRef str(PyObject_GetAttrString( o , const_cast< char * >("value") ),SAL_NO_ACQUIRE);
             Sequence< sal_Int8 > seq;
@@ -788,6 +899,16 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
 #endif
             a <<= seq;                                                          
         }
+#if PY_VERSION_HEX >= 0x03000000
+        else if( PyBytes_Check( o ) )
+        {
+            a <<= Sequence< sal_Int8 >( (sal_Int8 *) PyBytes_AS_STRING( o ), PyBytes_GET_SIZE( o ) );
+        }
+        else if( PyByteArray_Check( o ) )
+        {
+            a <<= Sequence< sal_Int8 >( (sal_Int8 *) PyByteArray_AS_STRING( o ), PyByteArray_GET_SIZE( o ) );
+        }
+#endif
         else 
         if( PyObject_IsInstance( o, getTypeClass( runtime ).get() ) )
         {
@@ -798,30 +919,16 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
         {
             a = PyEnum2Enum( o );
         }
-        else if( isInstanceOfStructOrException( o ) )
-        {
-            PyRef struc(PyObject_GetAttrString( o , const_cast< char * >("value") ),SAL_NO_ACQUIRE);
-            PyUNO * obj = (PyUNO*)struc.get();
-            Reference< XMaterialHolder > holder( obj->members->xInvocation, UNO_QUERY );
-            if( holder.is( ) )
-                a = holder->getMaterial();
-            else
-            {
-                throw RuntimeException(
-                    USTR_ASCII( "struct or exception wrapper does not support XMaterialHolder" ),
-                    Reference< XInterface > () );
-            }
-        }
         else if( PyObject_IsInstance( o, getPyUnoClass().get() ) )
         {
             PyUNO* o_pi;
             o_pi = (PyUNO*) o;
-            if (o_pi->members->wrappedObject.getValueTypeClass () ==
+            if (o_pi->members.wrappedObject.getValueTypeClass () ==
                 com::sun::star::uno::TypeClass_STRUCT ||
-                o_pi->members->wrappedObject.getValueTypeClass () ==
+                o_pi->members.wrappedObject.getValueTypeClass () ==
                 com::sun::star::uno::TypeClass_EXCEPTION)
             {
-                Reference<XMaterialHolder> my_mh (o_pi->members->xInvocation, UNO_QUERY);
+                Reference<XMaterialHolder> my_mh (o_pi->members.xInvocation, UNO_QUERY);
 
                 if (!my_mh.is ())
                 {
@@ -834,7 +941,7 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
             }
             else
             {
-                a = o_pi->members->wrappedObject;
+                a = o_pi->members.wrappedObject;
             }
         }
         else if( PyObject_IsInstance( o, getCharClass( runtime ).get() ) )
@@ -846,10 +953,14 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
         {
             if( ACCEPT_UNO_ANY == mode )
             {
-                a = pyObject2Any( PyRef( PyObject_GetAttrString( o , const_cast< char * >("value") ), SAL_NO_ACQUIRE) );
+                PyRef value( PyObject_GetAttrString( o , const_cast< char * >("value") ), SAL_NO_ACQUIRE);
                 Type t;
                 pyObject2Any( PyRef( PyObject_GetAttrString( o, const_cast< char * >("type") ), SAL_NO_ACQUIRE ) ) >>= t;
 
+                // the type converter can't turn property values into named values
+                if( t == getCppuType( (Sequence< NamedValue > *) 0 ) && isMapping( *this, value.get() ) )
+                    return mapping2NamedValues( *this, value.get(), true, mode );
+                a = pyObject2Any( value );
                 try
                 {
                     a = getImpl()->cargo->xTypeConverter->convertTo( a, t );
@@ -871,47 +982,52 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
         else
         {
             Reference< XInterface > mappedObject;
-            Reference< XInvocation > adapterObject;
-            
-            // instance already mapped out to the world ?
-            PyRef2Adapter::iterator ii = impl->cargo->mappedObjects.find( PyRef( o ) );
-            if( ii != impl->cargo->mappedObjects.end() )
-            {
-                adapterObject = ii->second;
-            }
 
-            if( adapterObject.is() )
+            // instance already mapped out to the world ?
+            AdapterMap & adapters = getAdapterMap();
+            Adapter *pAdapter = adapters.lookup( o );
+            if( pAdapter )
             {
                 // object got already bridged !
-                Reference< com::sun::star::lang::XUnoTunnel > tunnel( adapterObject, UNO_QUERY );
-                
-                Adapter *pAdapter = ( Adapter * )
-                    sal::static_int_cast< sal_IntPtr >(
-                        tunnel->getSomething(
-                            ::pyuno::Adapter::getUnoTunnelImplementationId() ) );
-                
-                mappedObject = impl->cargo->xAdapterFactory->createAdapter(
-                    adapterObject, pAdapter->getWrappedTypes() );
+                mappedObject = createBinaryAdapter( pAdapter );
+                pAdapter->release();
             }
             else 
             {
                 Sequence< Type > interfaces = invokeGetTypes( *this, o );
                 if( interfaces.getLength() )
                 {
-                    Adapter *pAdapter = new Adapter( o, interfaces );
-                    mappedObject = 
-                        getImpl()->cargo->xAdapterFactory->createAdapter(
-                            pAdapter, interfaces );
-                    
+                    pAdapter = new Adapter( o, interfaces );
+                    mappedObject = createBinaryAdapter( pAdapter );
+
                     // keep a list of exported objects to ensure object identity !
-                    impl->cargo->mappedObjects[ PyRef(o) ] =
-                        com::sun::star::uno::WeakReference< XInvocation > ( pAdapter );
+                    adapters.insert( o, pAdapter );
+                }
+            }
+            bool bMapping = false;
+            PyRef iterator;
+            if( ! mappedObject.is() )
+            {
+                bMapping = isMapping( *this, o );
+                if( ! bMapping && isSequence( *this, o ) )
+                {
+                    iterator = PyRef( PyObject_GetIter( o ), SAL_NO_ACQUIRE );
+                    if( ! iterator.is() )
+                        PyErr_Clear();
                 }
             }
             if( mappedObject.is() )
             {
                 a = com::sun::star::uno::makeAny( mappedObject );
             }
+            else if( bMapping )
+            {
+                a = mapping2NamedValues( *this, o, false, mode );
+            }
+            else if( iterator.is() )
+            {
+                a <<= iterable2Sequence( *this, o, iterator, mode );
+            }
             else
             {
                 OUStringBuffer buf;
@@ -930,13 +1046,15 @@ Any Runtime::pyObject2Any ( const PyRef & source, enum ConversionMode mode ) con
     return a;
 }
 
-Any Runtime::extractUnoException( const PyRef & excType, const PyRef &excValue, const PyRef &excTraceback) const
+/** @return the printable stack trace of excTraceback, rendered by
+    uno._uno_extract_printable_stacktrace
+*/
+static PyRef getPrintableTraceback( RuntimeCargo *cargo, const PyRef &excTraceback )
 {
     PyRef str;
-    Any ret;
     if( excTraceback.is() )
     {
-        PyRef unoModule( impl ? impl->cargo->getUnoModule() : 0 );
+        PyRef unoModule( cargo ? cargo->getUnoModule() : 0 );
         if( unoModule.is() )
         {
             PyRef extractTraceback(
@@ -984,13 +1102,21 @@ Any Runtime::extractUnoException( const PyRef & excType, const PyRef &excValue,
         str = PyRef( PyString_FromString( "no traceback available" ), SAL_NO_ACQUIRE);
 #endif
     }
-    
+    return str;
+}
+
+Any Runtime::extractUnoException( const PyRef & excType, const PyRef &excValue, const PyRef &excTraceback) const
+{
+    // uno exceptions carry their own message, the traceback is only rendered
+    // into the message of the RuntimeException replacing a python exception
+    Any ret;
     if( isInstanceOfStructOrException( excValue.get() ) )
     {
         ret = pyObject2Any( excValue );
     }
     else
     {
+        PyRef str( getPrintableTraceback( impl ? impl->cargo : 0, excTraceback ) );
         OUStringBuffer buf;
         PyRef typeName( PyObject_Str( excType.get() ), SAL_NO_ACQUIRE );
         if( typeName.is() )
@@ -1081,6 +1207,9 @@ PyThreadAttach::PyThreadAttach( PyInterpreterState *interp)
 
 PyThreadAttach::~PyThreadAttach()
 {
+    // the call from UNO is finished here. The pending call may not get run,
+    // when the main thread doesn't execute python code
+    releasePendingPyObjects();
     PyObject *value =
         PyDict_GetItemString( PyThreadState_GetDict( ), g_NUMERICID );
     if( value )
@@ -1124,4 +1253,15 @@ PyRef RuntimeCargo::getUnoModule()
     }
     return dictUnoModule;
 }
+
+RuntimeCargo::~RuntimeCargo()
+{
+    delete typeIndex;
+    // exported adapters may still use their class
+    for( AdapterClassMap::iterator ii = adapterClasses.map.begin();
+         ii != adapterClasses.map.end() ; ++ii )
+    {
+        ii->second->release();
+    }
+}
 }
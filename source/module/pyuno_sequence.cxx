@@ -0,0 +1,532 @@
+/**************************************************************
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *************************************************************/
+
+
+#include "pyuno_impl.hxx"
+
+#include <osl/interlck.h>
+
+#include <uno/data.h>
+#include <uno/sequence2.h>
+#include <typelib/typedescription.hxx>
+
+#include <com/sun/star/uno/genfunc.hxx>
+
+using com::sun::star::uno::Any;
+using com::sun::star::uno::makeAny;
+using com::sun::star::uno::RuntimeException;
+using com::sun::star::uno::cpp_release;
+
+namespace pyuno
+{
+
+/** Immutable python view of a UNO sequence. The sequence is shared with the
+    Any it was created from and handed back to UNO unchanged.
+*/
+typedef struct
+{
+    PyObject_HEAD
+    uno_Sequence *pSequence;
+    typelib_TypeDescription *pTypeDescr; // of the sequence
+    typelib_TypeDescriptionReference *pElementType;
+    sal_Int32 nElementSize;
+} PyUNOSequence;
+
+extern PyTypeObject PyUNOSequenceType;
+
+/** iterator over a PyUNOSequence, converts one element per step */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *sequence;
+    Py_ssize_t index;
+} PyUNOSequenceIterator;
+
+extern PyTypeObject PyUNOSequenceIteratorType;
+
+static PyObject *getElement( PyUNOSequence *self, Py_ssize_t i )
+{
+    try
+    {
+        Runtime runtime;
+        Any a( (char *) self->pSequence->elements + i * self->nElementSize, self->pElementType );
+        return runtime.any2PyObject( a ).getAcquired();
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+/** @return a new tuple of length elements, beginning at start in steps of step */
+static PyObject *toTuple( PyUNOSequence *self, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length )
+{
+    PyRef tuple( PyTuple_New( length ), SAL_NO_ACQUIRE );
+    if( ! tuple.is() )
+        return 0;
+    for( Py_ssize_t i = 0 ; i < length ; i ++ )
+    {
+        PyObject *element = getElement( self, start + i * step );
+        if( ! element )
+            return 0;
+        PyTuple_SET_ITEM( tuple.get(), i, element );
+    }
+    return tuple.getAcquired();
+}
+
+static PyObject *toTuple( PyObject *self )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+    return toTuple( me, 0, 1, me->pSequence->nElements );
+}
+
+extern "C" {
+
+static void PyUNOSequence_del( PyObject *self )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+    uno_destructData( &me->pSequence, me->pTypeDescr, (uno_ReleaseFunc) cpp_release );
+    typelib_typedescription_release( me->pTypeDescr );
+    typelib_typedescriptionreference_release( me->pElementType );
+    PyObject_Del( self );
+}
+
+static Py_ssize_t PyUNOSequence_length( PyObject *self )
+{
+    return reinterpret_cast< PyUNOSequence * >( self )->pSequence->nElements;
+}
+
+static PyObject *PyUNOSequence_item( PyObject *self, Py_ssize_t i )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+    if( i < 0 || i >= me->pSequence->nElements )
+    {
+        PyErr_SetString( PyExc_IndexError, "sequence index out of range" );
+        return 0;
+    }
+    return getElement( me, i );
+}
+
+static PyObject *PyUNOSequence_subscript( PyObject *self, PyObject *key )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+    if( PyIndex_Check( key ) )
+    {
+        Py_ssize_t i = PyNumber_AsSsize_t( key, PyExc_IndexError );
+        if( i == -1 && PyErr_Occurred() )
+            return 0;
+        if( i < 0 )
+            i += me->pSequence->nElements;
+        return PyUNOSequence_item( self, i );
+    }
+    if( PySlice_Check( key ) )
+    {
+        Py_ssize_t start, stop, step, length;
+#if PY_VERSION_HEX >= 0x03020000
+        if( PySlice_GetIndicesEx( key, me->pSequence->nElements, &start, &stop, &step, &length ) < 0 )
+#else
+        if( PySlice_GetIndicesEx( (PySliceObject *) key, me->pSequence->nElements,
+                                  &start, &stop, &step, &length ) < 0 )
+#endif
+            return 0;
+        return toTuple( me, start, step, length );
+    }
+    PyErr_Format( PyExc_TypeError, "sequence indices must be integers, not %.200s",
+                  Py_TYPE( key )->tp_name );
+    return 0;
+}
+
+static PyObject *PyUNOSequence_concat( PyObject *self, PyObject *other )
+{
+    PyRef tuple( toTuple( self ), SAL_NO_ACQUIRE );
+    if( ! tuple.is() )
+        return 0;
+    return PySequence_Concat( tuple.get(), other );
+}
+
+static PyObject *PyUNOSequence_repr( PyObject *self )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+#if PY_VERSION_HEX >= 0x03000000
+    // like the repr of a tuple, one element converted at a time
+    Py_ssize_t n = me->pSequence->nElements;
+    if( ! n )
+        return PyUnicode_FromString( "()" );
+    PyRef reprs( PyList_New( n ), SAL_NO_ACQUIRE );
+    if( ! reprs.is() )
+        return 0;
+    for( Py_ssize_t i = 0 ; i < n ; i ++ )
+    {
+        PyRef element( getElement( me, i ), SAL_NO_ACQUIRE );
+        if( ! element.is() )
+            return 0;
+        PyObject *repr = PyObject_Repr( element.get() );
+        if( ! repr )
+            return 0;
+        PyList_SET_ITEM( reprs.get(), i, repr );
+    }
+    PyRef separator( PyUnicode_FromString( ", " ), SAL_NO_ACQUIRE );
+    if( ! separator.is() )
+        return 0;
+    PyRef joined( PyUnicode_Join( separator.get(), reprs.get() ), SAL_NO_ACQUIRE );
+    if( ! joined.is() )
+        return 0;
+    return PyUnicode_FromFormat( n == 1 ? "(%U,)" : "(%U)", joined.get() );
+#else
+    PyRef tuple( toTuple( self ), SAL_NO_ACQUIRE );
+    if( ! tuple.is() )
+        return 0;
+    return PyObject_Repr( tuple.get() );
+#endif
+}
+
+/** hashes like the tuple the sequence would have been converted to,
+    without creating it, as views compare equal to such tuples
+*/
+static Py_hash_t PyUNOSequence_hash( PyObject *self )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+    Py_ssize_t n = me->pSequence->nElements;
+#if PY_VERSION_HEX >= 0x03080000
+    // the xxHash based tuplehash of python 3.8
+#if SIZEOF_SIZE_T > 4
+    const size_t nPrime1 = (size_t) SAL_CONST_UINT64( 11400714785074694791 );
+    const size_t nPrime2 = (size_t) SAL_CONST_UINT64( 14029467366897019727 );
+    const size_t nPrime5 = (size_t) SAL_CONST_UINT64( 2870177450012600261 );
+#define PYUNO_HASH_ROTATE( x ) ( ( x << 31 ) | ( x >> 33 ) )
+#else
+    const size_t nPrime1 = 2654435761UL;
+    const size_t nPrime2 = 2246822519UL;
+    const size_t nPrime5 = 374761393UL;
+#define PYUNO_HASH_ROTATE( x ) ( ( x << 13 ) | ( x >> 19 ) )
+#endif
+    size_t acc = nPrime5;
+    for( Py_ssize_t i = 0 ; i < n ; i ++ )
+    {
+        PyRef element( getElement( me, i ), SAL_NO_ACQUIRE );
+        if( ! element.is() )
+            return -1;
+        size_t lane = (size_t) PyObject_Hash( element.get() );
+        if( lane == (size_t) -1 )
+            return -1;
+        acc += lane * nPrime2;
+        acc = PYUNO_HASH_ROTATE( acc );
+        acc *= nPrime1;
+    }
+#undef PYUNO_HASH_ROTATE
+    acc += (size_t) n ^ ( nPrime5 ^ 3527539UL );
+    if( acc == (size_t) -1 )
+        return 1546275796;
+    return (Py_hash_t) acc;
+#else
+    size_t x = 0x345678UL;
+    size_t mult = 1000003UL;
+    for( Py_ssize_t i = 0 ; i < n ; i ++ )
+    {
+        PyRef element( getElement( me, i ), SAL_NO_ACQUIRE );
+        if( ! element.is() )
+            return -1;
+        Py_hash_t y = PyObject_Hash( element.get() );
+        if( y == -1 )
+            return -1;
+        x = ( x ^ (size_t) y ) * mult;
+        mult += (size_t)( 82520UL + 2 * ( n - i - 1 ) );
+    }
+    x += 97531UL;
+    if( x == (size_t) -1 )
+        x = (size_t) -2;
+    return (Py_hash_t) x;
+#endif
+}
+
+/** @return the new reference of an element of a tuple or a view */
+static PyObject *getItem( PyObject *o, Py_ssize_t i )
+{
+    if( PyTuple_Check( o ) )
+    {
+        PyObject *item = PyTuple_GET_ITEM( o, i );
+        Py_INCREF( item );
+        return item;
+    }
+    return getElement( reinterpret_cast< PyUNOSequence * >( o ), i );
+}
+
+/** compares like the tuple the sequence would have been converted to,
+    element by element
+*/
+static PyObject *PyUNOSequence_richcompare( PyObject *self, PyObject *that, int op )
+{
+    if( ! PyTuple_Check( that ) && ! PyUNOSequence_Check( that ) )
+    {
+        Py_INCREF( Py_NotImplemented );
+        return Py_NotImplemented;
+    }
+    Py_ssize_t nSelf = PyUNOSequence_length( self );
+    Py_ssize_t nThat = PyUNOSequence_Check( that ) ? PyUNOSequence_length( that ) : PyTuple_GET_SIZE( that );
+    if( nSelf != nThat && ( op == Py_EQ || op == Py_NE ) )
+        return PyBool_FromLong( op == Py_NE );
+
+    Py_ssize_t i = 0;
+    for( ; i < nSelf && i < nThat ; i ++ )
+    {
+        PyRef a( getItem( self, i ), SAL_NO_ACQUIRE );
+        PyRef b( getItem( that, i ), SAL_NO_ACQUIRE );
+        if( ! a.is() || ! b.is() )
+            return 0;
+        int equal = PyObject_RichCompareBool( a.get(), b.get(), Py_EQ );
+        if( equal < 0 )
+            return 0;
+        if( ! equal )
+        {
+            if( op == Py_EQ || op == Py_NE )
+                return PyBool_FromLong( op == Py_NE );
+            return PyObject_RichCompare( a.get(), b.get(), op );
+        }
+    }
+
+    // all common elements are equal, the lengths decide
+    bool bResult = false;
+    switch( op )
+    {
+    case Py_LT: bResult = nSelf < nThat; break;
+    case Py_LE: bResult = nSelf <= nThat; break;
+    case Py_EQ: bResult = nSelf == nThat; break;
+    case Py_NE: bResult = nSelf != nThat; break;
+    case Py_GT: bResult = nSelf > nThat; break;
+    case Py_GE: bResult = nSelf >= nThat; break;
+    }
+    return PyBool_FromLong( bResult );
+}
+
+static int PyUNOSequence_contains( PyObject *self, PyObject *value )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( self );
+    for( Py_ssize_t i = 0 ; i < me->pSequence->nElements ; i ++ )
+    {
+        PyRef element( getElement( me, i ), SAL_NO_ACQUIRE );
+        if( ! element.is() )
+            return -1;
+        int ret = PyObject_RichCompareBool( element.get(), value, Py_EQ );
+        if( ret != 0 )
+            return ret;
+    }
+    return 0;
+}
+
+static PyObject *PyUNOSequence_iter( PyObject *self )
+{
+    PyUNOSequenceIterator *it = PyObject_New( PyUNOSequenceIterator, &PyUNOSequenceIteratorType );
+    if( ! it )
+        return 0;
+    Py_INCREF( self );
+    it->sequence = self;
+    it->index = 0;
+    return reinterpret_cast< PyObject * >( it );
+}
+
+static void PyUNOSequenceIterator_del( PyObject *self )
+{
+    Py_DECREF( reinterpret_cast< PyUNOSequenceIterator * >( self )->sequence );
+    PyObject_Del( self );
+}
+
+static PyObject *PyUNOSequenceIterator_next( PyObject *self )
+{
+    PyUNOSequenceIterator *it = reinterpret_cast< PyUNOSequenceIterator * >( self );
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( it->sequence );
+    if( it->index >= me->pSequence->nElements )
+        return 0; // the end, without setting StopIteration
+    return getElement( me, it->index ++ );
+}
+
+}
+
+static PySequenceMethods PyUNOSequence_as_sequence =
+{
+    PyUNOSequence_length, /* sq_length */
+    PyUNOSequence_concat, /* sq_concat */
+    0, /* sq_repeat */
+    PyUNOSequence_item, /* sq_item */
+    0, /* sq_slice */
+    0, /* sq_ass_item */
+    0, /* sq_ass_slice */
+    PyUNOSequence_contains, /* sq_contains */
+    0, /* sq_inplace_concat */
+    0 /* sq_inplace_repeat */
+};
+
+static PyMappingMethods PyUNOSequence_as_mapping =
+{
+    PyUNOSequence_length, /* mp_length */
+    PyUNOSequence_subscript, /* mp_subscript */
+    0 /* mp_ass_subscript */
+};
+
+PyTypeObject PyUNOSequenceType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.UNOSequence"), /* tp_name */
+    sizeof (PyUNOSequence), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOSequence_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) PyUNOSequence_repr, /* tp_repr */
+    0, /* tp_as_number */
+    &PyUNOSequence_as_sequence, /* tp_as_sequence */
+    &PyUNOSequence_as_mapping, /* tp_as_mapping */
+    (hashfunc) PyUNOSequence_hash, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) 0, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT, /* tp_flags */
+    NULL, /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    PyUNOSequence_richcompare, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) PyUNOSequence_iter, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    NULL, /* tp_methods */
+    NULL, /* tp_members */
+    NULL, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) 0, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) 0, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+PyTypeObject PyUNOSequenceIteratorType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.UNOSequenceIterator"), /* tp_name */
+    sizeof (PyUNOSequenceIterator), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOSequenceIterator_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) 0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) 0, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) 0, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT, /* tp_flags */
+    NULL, /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    0, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) PyObject_SelfIter, /* tp_iter */
+    (iternextfunc) PyUNOSequenceIterator_next, /* tp_iternext */
+    NULL, /* tp_methods */
+    NULL, /* tp_members */
+    NULL, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) 0, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) 0, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+PyRef PyUNOSequence_new( const Any &a, const Runtime & )
+{
+    PyUNOSequence *self = PyObject_New( PyUNOSequence, &PyUNOSequenceType );
+    if( ! self )
+        throw RuntimeException(
+            rtl::OUString( RTL_CONSTASCII_USTRINGPARAM( "cannot instantiate pyuno sequence" ) ),
+            com::sun::star::uno::Reference< com::sun::star::uno::XInterface > () );
+
+    self->pSequence = *(uno_Sequence **) a.getValue();
+    osl_incrementInterlockedCount( &self->pSequence->nRefCount );
+    self->pTypeDescr = 0;
+    typelib_typedescriptionreference_getDescription( &self->pTypeDescr, a.getValueTypeRef() );
+    self->pElementType =
+        reinterpret_cast< typelib_IndirectTypeDescription * >( self->pTypeDescr )->pType;
+    typelib_typedescriptionreference_acquire( self->pElementType );
+
+    typelib_TypeDescription *pElementTypeDescr = 0;
+    TYPELIB_DANGER_GET( &pElementTypeDescr, self->pElementType );
+    self->nElementSize = pElementTypeDescr->nSize;
+    TYPELIB_DANGER_RELEASE( pElementTypeDescr );
+    return PyRef( reinterpret_cast< PyObject * >( self ), SAL_NO_ACQUIRE );
+}
+
+bool PyUNOSequence_Check( PyObject *obj )
+{
+    return Py_TYPE( obj ) == &PyUNOSequenceType;
+}
+
+Any PyUNOSequence_getValue( PyObject *obj )
+{
+    PyUNOSequence *me = reinterpret_cast< PyUNOSequence * >( obj );
+    return Any( &me->pSequence, me->pTypeDescr );
+}
+
+bool initSequenceType( PyObject *module )
+{
+    if( PyType_Ready( &PyUNOSequenceType ) < 0 || PyType_Ready( &PyUNOSequenceIteratorType ) < 0 )
+        return false;
+    Py_INCREF( &PyUNOSequenceType );
+    return PyModule_AddObject( module, "UNOSequence", (PyObject *) &PyUNOSequenceType ) == 0;
+}
+
+}
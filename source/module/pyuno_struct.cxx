@@ -0,0 +1,1038 @@
+/**************************************************************
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *************************************************************/
+
+
+#include "pyuno_impl.hxx"
+
+#include <rtl/ustrbuf.hxx>
+#include <rtl/alloc.h>
+#include <osl/interlck.h>
+
+#include <uno/data.h>
+#include <typelib/typedescription.hxx>
+
+#include <com/sun/star/uno/genfunc.hxx>
+
+using rtl::OUString;
+using rtl::OString;
+using rtl::OUStringBuffer;
+using rtl::OUStringToOString;
+
+using com::sun::star::uno::Any;
+using com::sun::star::uno::Type;
+using com::sun::star::uno::makeAny;
+using com::sun::star::uno::Reference;
+using com::sun::star::uno::XInterface;
+using com::sun::star::uno::RuntimeException;
+using com::sun::star::uno::cpp_queryInterface;
+using com::sun::star::uno::cpp_acquire;
+using com::sun::star::uno::cpp_release;
+
+namespace pyuno
+{
+
+/** Member of a UNO struct, precompiled from its compound type description. */
+struct StructMember
+{
+    sal_Int32 nOffset;
+    typelib_TypeDescriptionReference *pTypeRef;
+    PyObject *name; // interned
+    typelib_CompoundTypeDescription *pDeclaringType; // held by the class
+    PyObject *memberClass; // weak reference to the class of a struct typed member
+    RuntimeCargo *memberCargo; // the runtime of memberClass
+};
+
+/** Constructor data of a generated struct or exception class, the members
+    of the base types come first, in initializer order. Shared by the classes
+    generated for the type and released by their capsules.
+*/
+struct StructClass
+{
+    sal_Int32 nRefCount; // only changed with the global interpreter lock held
+    typelib_TypeDescription *pTypeDescr;
+    sal_Int32 nMembers;
+    StructMember *pMembers;
+    PyGetSetDef *pGetSets; // of the members declared by the type itself
+};
+
+typedef ::std::hash_map
+<
+    OUString,
+    StructClass *,
+    rtl::OUStringHash,
+    std::equal_to< OUString >
+> StructClassMap;
+
+static const char STRUCT_CLASS_CAPSULE[] = "pyuno.StructClass";
+
+/** Refcounted UNO value buffer, shared by the instances holding equal
+    values until one of them is mutated.
+*/
+struct StructValue
+{
+    oslInterlockedCount nRefCount;
+    typelib_TypeDescription *pTypeDescr;
+};
+
+static const sal_Int32 STRUCT_VALUE_HEADER = ( sizeof( StructValue ) + 15 ) & ~15;
+
+static void *getValueData( StructValue *pValue )
+{
+    return (char *) pValue + STRUCT_VALUE_HEADER;
+}
+
+/** @return a new value with unconstructed data */
+static StructValue *createStructValue( typelib_TypeDescription *pTypeDescr )
+{
+    StructValue *pValue = (StructValue *) rtl_allocateMemory( STRUCT_VALUE_HEADER + pTypeDescr->nSize );
+    pValue->nRefCount = 1;
+    pValue->pTypeDescr = pTypeDescr;
+    typelib_typedescription_acquire( pTypeDescr );
+    return pValue;
+}
+
+static void acquireStructValue( StructValue *pValue )
+{
+    osl_incrementInterlockedCount( &pValue->nRefCount );
+}
+
+static void releaseStructValue( StructValue *pValue )
+{
+    if( osl_decrementInterlockedCount( &pValue->nRefCount ) == 0 )
+    {
+        uno_destructData( getValueData( pValue ), pValue->pTypeDescr, (uno_ReleaseFunc) cpp_release );
+        typelib_typedescription_release( pValue->pTypeDescr );
+        rtl_freeMemory( pValue );
+    }
+}
+
+/** Sets the value of the instance, taking over the reference of pValue. */
+static void setStructValue( PyUNOStructData *p, StructValue *pValue )
+{
+    StructValue *pOld = p->pValue;
+    p->pValue = pValue;
+    p->pTypeDescr = pValue ? pValue->pTypeDescr : 0;
+    p->pData = pValue ? getValueData( pValue ) : 0;
+    if( pOld )
+        releaseStructValue( pOld );
+}
+
+/** @return the data of the instance, copied first if the value is shared
+    or the instance is a view of a member of another value
+*/
+static void *getWritableData( PyUNOStructData *p )
+{
+    if( p->pValue->nRefCount > 1 || p->pData != getValueData( p->pValue ) )
+    {
+        StructValue *pCopy = createStructValue( p->pTypeDescr );
+        uno_copyData( getValueData( pCopy ), p->pData, p->pTypeDescr, (uno_AcquireFunc) cpp_acquire );
+        setStructValue( p, pCopy );
+    }
+    return p->pData;
+}
+
+extern PyTypeObject PyUNOStructType;
+extern PyTypeObject PyUNOExceptionType;
+
+PyUNOStructData *getStructData( PyObject *obj )
+{
+    if( PyObject_TypeCheck( obj, &PyUNOStructType ) )
+        return &reinterpret_cast< PyUNOStruct * >( obj )->value;
+    if( PyObject_TypeCheck( obj, &PyUNOExceptionType ) )
+        return &reinterpret_cast< PyUNOException * >( obj )->value;
+    return 0;
+}
+
+static typelib_TypeDescriptionReference *getAnyTypeRef()
+{
+    return ::getCppuType( (const Any *) 0 ).getTypeLibType();
+}
+
+/** Assigns a python value to the UNO value at pDest, converting it with the
+    type converter when a plain assignment is not possible.
+*/
+static void assignMember(
+    void *pDest, typelib_TypeDescriptionReference *pTypeRef,
+    PyObject *value, const Runtime &runtime )
+{
+    Any a = runtime.pyObject2Any( value, ACCEPT_UNO_ANY );
+    if( uno_type_assignData(
+            pDest, pTypeRef, &a, getAnyTypeRef(),
+            (uno_QueryInterfaceFunc) cpp_queryInterface,
+            (uno_AcquireFunc) cpp_acquire, (uno_ReleaseFunc) cpp_release ) )
+        return;
+
+    Any converted = runtime.getImpl()->cargo->xTypeConverter->convertTo( a, Type( pTypeRef ) );
+    if( ! uno_type_assignData(
+            pDest, pTypeRef, &converted, getAnyTypeRef(),
+            (uno_QueryInterfaceFunc) cpp_queryInterface,
+            (uno_AcquireFunc) cpp_acquire, (uno_ReleaseFunc) cpp_release ) )
+    {
+        OUStringBuffer buf;
+        buf.appendAscii( "cannot assign a value of type " );
+        buf.append( a.getValueTypeName() );
+        buf.appendAscii( " to a struct member of type " );
+        buf.append( OUString( pTypeRef->pTypeName ) );
+        throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () );
+    }
+}
+
+static sal_Int32 countMembers( typelib_CompoundTypeDescription *pCompType )
+{
+    sal_Int32 n = 0;
+    for( ; pCompType ; pCompType = pCompType->pBaseTypeDescription )
+        n += pCompType->nMembers;
+    return n;
+}
+
+/** @return index of the next member to be collected */
+static sal_Int32 collectMembers( typelib_CompoundTypeDescription *pCompType, StructMember *pMembers )
+{
+    sal_Int32 nIndex = 0;
+    if( pCompType->pBaseTypeDescription )
+        nIndex = collectMembers( pCompType->pBaseTypeDescription, pMembers );
+
+    for( sal_Int32 i = 0 ; i < pCompType->nMembers ; i ++ )
+    {
+        StructMember & member = pMembers[ nIndex + i ];
+        member.nOffset = pCompType->pMemberOffsets[i];
+        member.pTypeRef = pCompType->ppTypeRefs[i];
+        typelib_typedescriptionreference_acquire( member.pTypeRef );
+        member.name = ustring2PyInternedString( pCompType->ppMemberNames[i] ).getAcquired();
+        member.pDeclaringType = pCompType;
+        member.memberClass = 0;
+        member.memberCargo = 0;
+    }
+    return nIndex + pCompType->nMembers;
+}
+
+static StructClass *getStructClass( PyTypeObject *type )
+{
+    static PyObject *key = 0;
+    if( ! key )
+        key = ustring2PyInternedString(
+            OUString( RTL_CONSTASCII_USTRINGPARAM( "__pyunostructclass__" ) ) ).getAcquired();
+
+    PyObject *capsule = _PyType_Lookup( type, key );
+    if( ! capsule || ! PyCapsule_CheckExact( capsule ) )
+        return 0;
+    return static_cast< StructClass * >( PyCapsule_GetPointer( capsule, STRUCT_CLASS_CAPSULE ) );
+}
+
+static sal_Int32 findMember( const StructClass *pClass, PyObject *name )
+{
+    for( sal_Int32 i = 0 ; i < pClass->nMembers ; i ++ )
+    {
+        if( pClass->pMembers[i].name == name )
+            return i;
+    }
+    if( PyUnicode_Check( name ) )
+    {
+        for( sal_Int32 i = 0 ; i < pClass->nMembers ; i ++ )
+        {
+            if( PyUnicode_Compare( pClass->pMembers[i].name, name ) == 0 )
+                return i;
+        }
+    }
+    return -1;
+}
+
+static void setExceptionArgs( PyObject *self )
+{
+    PyUNOStructData *p = getStructData( self );
+    // the Message of com.sun.star.uno.Exception is always the first member
+    PyRef args( PyTuple_New( 1 ), SAL_NO_ACQUIRE );
+    PyTuple_SetItem( args.get(), 0, ustring2PyUnicode( *(OUString *) p->pData ).getAcquired() );
+    PyBaseExceptionObject *exc = reinterpret_cast< PyBaseExceptionObject * >( self );
+    PyObject *old = exc->args;
+    exc->args = args.getAcquired();
+    Py_XDECREF( old );
+    reinterpret_cast< PyUNOException * >( self )->bArgsPending = false;
+}
+
+/** builds the args of an exception converted from UNO, which are not needed
+    by most exceptions raised through the bridge
+*/
+static void ensureExceptionArgs( PyObject *self )
+{
+    if( reinterpret_cast< PyUNOException * >( self )->bArgsPending )
+        setExceptionArgs( self );
+}
+
+/** Allocates an instance of type holding pValue, the reference of pValue
+    is taken over in any case.
+*/
+static PyObject *allocStruct( PyTypeObject *type, StructValue *pValue )
+{
+    PyObject *self;
+    if( PyType_IsSubtype( type, &PyUNOExceptionType ) )
+    {
+        PyRef args( PyTuple_New( 0 ), SAL_NO_ACQUIRE );
+        self = reinterpret_cast< PyTypeObject * >( PyExc_Exception )->tp_new( type, args.get(), 0 );
+        if( self )
+            reinterpret_cast< PyUNOException * >( self )->bArgsPending = false;
+    }
+    else
+        self = type->tp_alloc( type, 0 );
+    if( ! self )
+    {
+        releaseStructValue( pValue );
+        return 0;
+    }
+    setStructValue( getStructData( self ), pValue );
+    return self;
+}
+
+/** Allocates an instance of type viewing the value at pData, which lies
+    within the value of pSource.
+*/
+static PyObject *allocStructView(
+    PyTypeObject *type, const PyUNOStructData *pSource,
+    typelib_TypeDescription *pTypeDescr, void *pData )
+{
+    acquireStructValue( pSource->pValue );
+    PyObject *self = allocStruct( type, pSource->pValue );
+    if( self )
+    {
+        PyUNOStructData *p = getStructData( self );
+        p->pTypeDescr = pTypeDescr;
+        p->pData = pData;
+    }
+    return self;
+}
+
+PyRef PyUNOStruct_new( const Any &a, const Runtime &runtime )
+{
+    PyRef cls = getClass( a.getValueType().getTypeName(), runtime );
+    PyTypeObject *type = reinterpret_cast< PyTypeObject * >( cls.get() );
+    StructClass *pClass = getStructClass( type );
+    PyRef ret;
+    if( pClass )
+    {
+        StructValue *pValue = createStructValue( pClass->pTypeDescr );
+        uno_copyData( getValueData( pValue ), (void *) a.getValue(),
+                      pClass->pTypeDescr, (uno_AcquireFunc) cpp_acquire );
+        ret = PyRef( allocStruct( type, pValue ), SAL_NO_ACQUIRE );
+    }
+    if( ! ret.is() )
+    {
+        OUStringBuffer buf;
+        buf.appendAscii( "Couldn't instantiate python representation of structered UNO type " );
+        buf.append( a.getValueType().getTypeName() );
+        throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () );
+    }
+    if( a.getValueTypeClass() == com::sun::star::uno::TypeClass_EXCEPTION )
+        reinterpret_cast< PyUNOException * >( ret.get() )->bArgsPending = true;
+    return ret;
+}
+
+static sal_Int64 hashData( const void *pData, typelib_TypeDescriptionReference *pTypeRef );
+
+static sal_Int64 combineHash( sal_Int64 nHash, sal_Int64 nValue )
+{
+    return ( nHash * 1000003 ) ^ nValue;
+}
+
+/** numbers equal to uno_type_equalData hash equally, whatever their type */
+static sal_Int64 hashNumber( double fValue )
+{
+    if( fValue >= -9.2e18 && fValue <= 9.2e18 && fValue == (double)(sal_Int64) fValue )
+        return (sal_Int64) fValue;
+    sal_Int64 nBits;
+    memcpy( &nBits, &fValue, sizeof( nBits ) );
+    return nBits;
+}
+
+static sal_Int64 hashCompound( const void *pData, typelib_CompoundTypeDescription *pCompType )
+{
+    sal_Int64 nHash = pCompType->pBaseTypeDescription
+        ? hashCompound( pData, pCompType->pBaseTypeDescription ) : 0x345678;
+    for( sal_Int32 i = 0 ; i < pCompType->nMembers ; i ++ )
+        nHash = combineHash(
+            nHash, hashData( (char *) pData + pCompType->pMemberOffsets[i], pCompType->ppTypeRefs[i] ) );
+    return nHash;
+}
+
+/** @return a hash of the value, consistent with uno_type_equalData. Interfaces
+    only contribute whether they are set, their identity would require a
+    queryInterface call.
+*/
+static sal_Int64 hashData( const void *pData, typelib_TypeDescriptionReference *pTypeRef )
+{
+    switch( pTypeRef->eTypeClass )
+    {
+    case typelib_TypeClass_CHAR:
+        return *(sal_Unicode *) pData;
+    case typelib_TypeClass_BOOLEAN:
+        return *(sal_Bool *) pData ? 1 : 0;
+    case typelib_TypeClass_BYTE:
+        return *(sal_Int8 *) pData;
+    case typelib_TypeClass_SHORT:
+        return *(sal_Int16 *) pData;
+    case typelib_TypeClass_UNSIGNED_SHORT:
+        return *(sal_uInt16 *) pData;
+    case typelib_TypeClass_LONG:
+    case typelib_TypeClass_ENUM:
+        return *(sal_Int32 *) pData;
+    case typelib_TypeClass_UNSIGNED_LONG:
+        return *(sal_uInt32 *) pData;
+    case typelib_TypeClass_HYPER:
+    case typelib_TypeClass_UNSIGNED_HYPER:
+        return *(sal_Int64 *) pData;
+    case typelib_TypeClass_FLOAT:
+        return hashNumber( *(float *) pData );
+    case typelib_TypeClass_DOUBLE:
+        return hashNumber( *(double *) pData );
+    case typelib_TypeClass_STRING:
+    {
+        rtl_uString *pStr = *(rtl_uString **) pData;
+        return rtl_ustr_hashCode_WithLength( pStr->buffer, pStr->length );
+    }
+    case typelib_TypeClass_TYPE:
+    {
+        rtl_uString *pName = (*(typelib_TypeDescriptionReference **) pData)->pTypeName;
+        return rtl_ustr_hashCode_WithLength( pName->buffer, pName->length );
+    }
+    case typelib_TypeClass_ANY:
+    {
+        const uno_Any *pAny = (const uno_Any *) pData;
+        return hashData( pAny->pData, pAny->pType );
+    }
+    case typelib_TypeClass_INTERFACE:
+        return *(void **) pData ? 1 : 0;
+    case typelib_TypeClass_STRUCT:
+    case typelib_TypeClass_EXCEPTION:
+    {
+        typelib_TypeDescription *pTypeDescr = 0;
+        TYPELIB_DANGER_GET( &pTypeDescr, pTypeRef );
+        sal_Int64 nHash = hashCompound( pData, (typelib_CompoundTypeDescription *) pTypeDescr );
+        TYPELIB_DANGER_RELEASE( pTypeDescr );
+        return nHash;
+    }
+    case typelib_TypeClass_SEQUENCE:
+    {
+        uno_Sequence *pSequence = *(uno_Sequence **) pData;
+        if( ! pSequence->nElements )
+            return 0;
+        typelib_TypeDescription *pTypeDescr = 0;
+        TYPELIB_DANGER_GET( &pTypeDescr, pTypeRef );
+        typelib_TypeDescription *pElementTypeDescr = 0;
+        TYPELIB_DANGER_GET( &pElementTypeDescr, ((typelib_IndirectTypeDescription *) pTypeDescr)->pType );
+        sal_Int64 nHash = pSequence->nElements;
+        for( sal_Int32 i = 0 ; i < pSequence->nElements ; i ++ )
+            nHash = combineHash(
+                nHash, hashData( pSequence->elements + i * pElementTypeDescr->nSize,
+                                 pElementTypeDescr->pWeakRef ) );
+        TYPELIB_DANGER_RELEASE( pElementTypeDescr );
+        TYPELIB_DANGER_RELEASE( pTypeDescr );
+        return nHash;
+    }
+    default:
+        return 0;
+    }
+}
+
+/** @return whether the value has the member, the member descriptors are
+    typed by the shared base and so may be applied to any UNO struct
+*/
+static bool hasMember( const PyUNOStructData *p, const StructMember *pMember )
+{
+    for( typelib_CompoundTypeDescription *pType = (typelib_CompoundTypeDescription *) p->pTypeDescr ;
+         pType ; pType = pType->pBaseTypeDescription )
+    {
+        if( typelib_typedescription_equals( &pType->aBase, &pMember->pDeclaringType->aBase ) )
+            return true;
+    }
+    return false;
+}
+
+static bool checkMember( PyObject *self, const StructMember *pMember )
+{
+    PyUNOStructData *p = getStructData( self );
+    if( p && hasMember( p, pMember ) )
+        return true;
+    OString name( OUStringToOString( pMember->pDeclaringType->aBase.pTypeName, RTL_TEXTENCODING_UTF8 ) );
+    PyErr_Format( PyExc_TypeError, "descriptor of '%s' applied to a '%s' instance",
+                  name.getStr(), Py_TYPE( self )->tp_name );
+    return false;
+}
+
+/** @return the class of a struct typed member. The class is referenced
+    weakly, so that it may still be dropped from the class cache, and is
+    only used for the runtime it was created by.
+*/
+static PyRef getMemberClass( StructMember *pMember, const Runtime & runtime )
+{
+    RuntimeCargo *cargo = runtime.getImpl()->cargo;
+    if( pMember->memberClass && pMember->memberCargo == cargo )
+    {
+        PyRef clazz( PyWeakref_GetObject( pMember->memberClass ) );
+        if( clazz.is() && clazz.get() != Py_None )
+            return clazz;
+    }
+    PyRef clazz = getClass( OUString( pMember->pTypeRef->pTypeName ), runtime );
+    Py_XDECREF( pMember->memberClass );
+    pMember->memberClass = PyWeakref_NewRef( clazz.get(), 0 );
+    if( ! pMember->memberClass )
+        PyErr_Clear();
+    pMember->memberCargo = cargo;
+    return clazz;
+}
+
+extern "C" {
+
+static PyObject *PyUNOStruct_getMember( PyObject *self, void *closure )
+{
+    StructMember *pMember = static_cast< StructMember * >( closure );
+    if( ! checkMember( self, pMember ) )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        PyUNOStructData *p = getStructData( self );
+        void *pData = (char *) p->pData + pMember->nOffset;
+        if( pMember->pTypeRef->eTypeClass == typelib_TypeClass_STRUCT )
+        {
+            // nested structs are views into this value, copied when modified
+            PyRef memberClass = getMemberClass( pMember, runtime );
+            PyTypeObject *type = reinterpret_cast< PyTypeObject * >( memberClass.get() );
+            StructClass *pMemberClass = getStructClass( type );
+            if( pMemberClass )
+                return allocStructView( type, p, pMemberClass->pTypeDescr, pData );
+        }
+        Any a( pData, pMember->pTypeRef );
+        return runtime.any2PyObject( a ).getAcquired();
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return 0;
+}
+
+static int PyUNOStruct_setMember( PyObject *self, PyObject *value, void *closure )
+{
+    if( ! value )
+    {
+        PyErr_SetString( PyExc_TypeError, "members of UNO structs cannot be deleted" );
+        return -1;
+    }
+    StructMember *pMember = static_cast< StructMember * >( closure );
+    if( ! checkMember( self, pMember ) )
+        return -1;
+    try
+    {
+        Runtime runtime;
+        PyUNOStructData *p = getStructData( self );
+        assignMember( (char *) getWritableData( p ) + pMember->nOffset, pMember->pTypeRef, value, runtime );
+        return 0;
+    }
+    catch( com::sun::star::script::CannotConvertException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( com::sun::star::lang::IllegalArgumentException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return -1;
+}
+
+static PyObject *PyUNOStruct_tp_new( PyTypeObject *type, PyObject *, PyObject * )
+{
+    StructClass *pClass = getStructClass( type );
+    if( ! pClass )
+    {
+        PyErr_Format( PyExc_TypeError, "cannot create '%s' instances", type->tp_name );
+        return 0;
+    }
+    StructValue *pValue = createStructValue( pClass->pTypeDescr );
+    uno_constructData( getValueData( pValue ), pClass->pTypeDescr );
+    return allocStruct( type, pValue );
+}
+
+static int PyUNOStruct_init( PyObject *self, PyObject *args, PyObject *kwds )
+{
+    StructClass *pClass = getStructClass( Py_TYPE( self ) );
+    if( ! pClass )
+        return 0;
+    try
+    {
+        Runtime runtime;
+        PyUNOStructData *p = getStructData( self );
+        Py_ssize_t nArgs = PyTuple_GET_SIZE( args );
+        Py_ssize_t nKwds = kwds ? PyDict_Size( kwds ) : 0;
+        if( nArgs == 1 && nKwds == 0 &&
+            PyObject_IsInstance( PyTuple_GET_ITEM( args, 0 ), (PyObject *) Py_TYPE( self ) ) )
+        {
+            // copy constructor, shares the value if the types match
+            PyUNOStructData *pOther = getStructData( PyTuple_GET_ITEM( args, 0 ) );
+            if( typelib_typedescription_equals( p->pTypeDescr, pOther->pTypeDescr ) )
+            {
+                acquireStructValue( pOther->pValue );
+                setStructValue( p, pOther->pValue );
+                p->pTypeDescr = pOther->pTypeDescr;
+                p->pData = pOther->pData;
+            }
+            else
+                uno_type_assignData(
+                    getWritableData( p ), p->pTypeDescr->pWeakRef, pOther->pData, pOther->pTypeDescr->pWeakRef,
+                    (uno_QueryInterfaceFunc) cpp_queryInterface,
+                    (uno_AcquireFunc) cpp_acquire, (uno_ReleaseFunc) cpp_release );
+        }
+        else if( nArgs > 0 || nKwds > 0 )
+        {
+            // positional initializers cover all members unless keywords are given
+            if( nArgs > pClass->nMembers || ( nKwds == 0 && nArgs != pClass->nMembers ) )
+            {
+                OUStringBuffer buf;
+                buf.append( OUString( p->pTypeDescr->pTypeName ) );
+                buf.appendAscii( ": wrong number of elements in the initializer list, expected " );
+                buf.append( pClass->nMembers );
+                buf.appendAscii( ", got " );
+                buf.append( (sal_Int32) nArgs );
+                throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () );
+            }
+            for( sal_Int32 i = 0 ; i < nArgs ; i ++ )
+            {
+                const StructMember & member = pClass->pMembers[i];
+                assignMember( (char *) getWritableData( p ) + member.nOffset, member.pTypeRef,
+                              PyTuple_GET_ITEM( args, i ), runtime );
+            }
+            Py_ssize_t pos = 0;
+            PyObject *key;
+            PyObject *value;
+            while( nKwds > 0 && PyDict_Next( kwds, &pos, &key, &value ) )
+            {
+                sal_Int32 i = findMember( pClass, key );
+                if( i < 0 )
+                {
+                    PyErr_Format( PyExc_TypeError, "%s has no member %R", Py_TYPE( self )->tp_name, key );
+                    return -1;
+                }
+                if( i < nArgs )
+                {
+                    PyErr_Format( PyExc_TypeError, "got multiple values for member %R", key );
+                    return -1;
+                }
+                const StructMember & member = pClass->pMembers[i];
+                assignMember( (char *) getWritableData( p ) + member.nOffset, member.pTypeRef, value, runtime );
+            }
+        }
+        if( p->pTypeDescr->eTypeClass == typelib_TypeClass_EXCEPTION )
+            setExceptionArgs( self );
+        return 0;
+    }
+    catch( com::sun::star::script::CannotConvertException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( com::sun::star::lang::IllegalArgumentException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( makeAny( e ) );
+    }
+    return -1;
+}
+
+static void PyUNOStruct_del( PyObject *self )
+{
+    setStructValue( getStructData( self ), 0 );
+    Py_TYPE( self )->tp_free( self );
+}
+
+static void PyUNOException_del( PyObject *self )
+{
+    setStructValue( getStructData( self ), 0 );
+    reinterpret_cast< PyTypeObject * >( PyExc_Exception )->tp_dealloc( self );
+}
+
+static PyObject *PyUNOStruct_repr( PyObject *self )
+{
+    PyUNOStructData *p = getStructData( self );
+    return ustring2PyUnicode( val2str( p->pData, p->pTypeDescr->pWeakRef ) ).getAcquired();
+}
+
+static PyObject *PyUNOStruct_richcompare( PyObject *self, PyObject *that, int op )
+{
+    PyUNOStructData *pOther = getStructData( that );
+    if( ( op != Py_EQ && op != Py_NE ) || ! pOther )
+    {
+        Py_INCREF( Py_NotImplemented );
+        return Py_NotImplemented;
+    }
+    PyUNOStructData *p = getStructData( self );
+    bool bEqual = ( p->pData == pOther->pData && p->pTypeDescr == pOther->pTypeDescr ) ||
+        uno_type_equalData(
+            p->pData, p->pTypeDescr->pWeakRef, pOther->pData, pOther->pTypeDescr->pWeakRef,
+            (uno_QueryInterfaceFunc) cpp_queryInterface, (uno_ReleaseFunc) cpp_release );
+    PyObject *ret = ( bEqual == ( op == Py_EQ ) ) ? Py_True : Py_False;
+    Py_INCREF( ret );
+    return ret;
+}
+
+/** hashes the content, so equal values may be used as dict keys. Like
+    other mutable keys a struct must not be modified while it is one.
+*/
+static Py_hash_t PyUNOStruct_hash( PyObject *self )
+{
+    PyUNOStructData *p = getStructData( self );
+    sal_Int64 nHash = hashCompound( p->pData, (typelib_CompoundTypeDescription *) p->pTypeDescr );
+    Py_hash_t ret = (Py_hash_t) ( nHash ^ ( nHash >> 32 ) );
+    return ret == -1 ? -2 : ret;
+}
+
+/** copy.copy and copy.deepcopy, the copy shares the value until either
+    side is modified.
+*/
+static PyObject *PyUNOStruct_copy( PyObject *self, PyObject * )
+{
+    PyUNOStructData *p = getStructData( self );
+    PyObject *ret = allocStructView( Py_TYPE( self ), p, p->pTypeDescr, p->pData );
+    if( ret && p->pTypeDescr->eTypeClass == typelib_TypeClass_EXCEPTION )
+        reinterpret_cast< PyUNOException * >( ret )->bArgsPending = true;
+    return ret;
+}
+
+static PyObject *PyUNOException_getArgs( PyObject *self, void * )
+{
+    ensureExceptionArgs( self );
+    PyObject *args = reinterpret_cast< PyBaseExceptionObject * >( self )->args;
+    Py_XINCREF( args );
+    return args;
+}
+
+static int PyUNOException_setArgs( PyObject *self, PyObject *value, void * )
+{
+    if( ! value )
+    {
+        PyErr_SetString( PyExc_TypeError, "args may not be deleted" );
+        return -1;
+    }
+    PyObject *args = PySequence_Tuple( value );
+    if( ! args )
+        return -1;
+    PyBaseExceptionObject *exc = reinterpret_cast< PyBaseExceptionObject * >( self );
+    PyObject *old = exc->args;
+    exc->args = args;
+    Py_XDECREF( old );
+    reinterpret_cast< PyUNOException * >( self )->bArgsPending = false;
+    return 0;
+}
+
+static PyObject *PyUNOException_str( PyObject *self )
+{
+    ensureExceptionArgs( self );
+    return reinterpret_cast< PyTypeObject * >( PyExc_Exception )->tp_str( self );
+}
+
+static PyObject *PyUNOException_repr( PyObject *self )
+{
+    ensureExceptionArgs( self );
+    return reinterpret_cast< PyTypeObject * >( PyExc_Exception )->tp_repr( self );
+}
+
+static PyObject *PyUNOException_reduce( PyObject *self, PyObject * )
+{
+    ensureExceptionArgs( self );
+    PyRef reduce( PyObject_GetAttrString( PyExc_Exception, "__reduce__" ), SAL_NO_ACQUIRE );
+    if( ! reduce.is() )
+        return 0;
+    return PyObject_CallFunctionObjArgs( reduce.get(), self, NULL );
+}
+
+static PyMethodDef PyUNOStruct_methods[] =
+{
+    { "__copy__", PyUNOStruct_copy, METH_NOARGS, NULL },
+    { "__deepcopy__", PyUNOStruct_copy, METH_O, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMethodDef PyUNOException_methods[] =
+{
+    { "__copy__", PyUNOStruct_copy, METH_NOARGS, NULL },
+    { "__deepcopy__", PyUNOStruct_copy, METH_O, NULL },
+    { "__reduce__", PyUNOException_reduce, METH_NOARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+// overrides the args of BaseException, which are built on first access
+static PyGetSetDef PyUNOException_getset[] =
+{
+    { const_cast< char * >( "args" ), PyUNOException_getArgs, PyUNOException_setArgs, NULL, NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+}
+
+PyTypeObject PyUNOStructType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.UNOStruct"), /* tp_name */
+    sizeof (PyUNOStruct), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOStruct_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) PyUNOStruct_repr, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) PyUNOStruct_hash, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) PyUNOStruct_repr, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    NULL, /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    PyUNOStruct_richcompare, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) 0, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    PyUNOStruct_methods, /* tp_methods */
+    NULL, /* tp_members */
+    NULL, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) PyUNOStruct_init, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) PyUNOStruct_tp_new, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+PyTypeObject PyUNOExceptionType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.UNOException"), /* tp_name */
+    sizeof (PyUNOException), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOException_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) PyUNOException_repr, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) PyUNOStruct_hash, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) PyUNOException_str, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags, gc support inherited */
+    NULL, /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    PyUNOStruct_richcompare, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) 0, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    PyUNOException_methods, /* tp_methods */
+    NULL, /* tp_members */
+    PyUNOException_getset, /* tp_getset */
+    NULL, /* tp_base, set by initStructTypes */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) PyUNOStruct_init, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) PyUNOStruct_tp_new, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+bool initStructTypes( PyObject *module )
+{
+    PyUNOExceptionType.tp_base = reinterpret_cast< PyTypeObject * >( PyExc_Exception );
+    if( PyType_Ready( &PyUNOStructType ) < 0 || PyType_Ready( &PyUNOExceptionType ) < 0 )
+        return false;
+    Py_INCREF( &PyUNOStructType );
+    Py_INCREF( &PyUNOExceptionType );
+    return PyModule_AddObject( module, "UNOStruct", (PyObject *) &PyUNOStructType ) == 0 &&
+        PyModule_AddObject( module, "UNOException", (PyObject *) &PyUNOExceptionType ) == 0;
+}
+
+static StructClassMap & getStructClasses()
+{
+    static StructClassMap *pClasses = new StructClassMap;
+    return *pClasses;
+}
+
+/** @return the class data of the type, acquired. The data is shared by all
+    classes generated for the type and freed with the last of them. Only
+    accessed with the global interpreter lock held.
+*/
+static StructClass *acquireStructClassData( typelib_CompoundTypeDescription *pCompType )
+{
+    StructClassMap & classes = getStructClasses();
+    OUString typeName( pCompType->aBase.pTypeName );
+    StructClassMap::const_iterator ii = classes.find( typeName );
+    if( ii != classes.end() )
+    {
+        ii->second->nRefCount ++;
+        return ii->second;
+    }
+
+    StructClass *pClass = new StructClass;
+    pClass->nRefCount = 1;
+    pClass->pTypeDescr = &pCompType->aBase;
+    typelib_typedescription_acquire( pClass->pTypeDescr );
+    pClass->nMembers = countMembers( pCompType );
+    pClass->pMembers = new StructMember[ pClass->nMembers ];
+    collectMembers( pCompType, pClass->pMembers );
+    pClass->pGetSets = new PyGetSetDef[ pCompType->nMembers ];
+    memset( pClass->pGetSets, 0, pCompType->nMembers * sizeof( PyGetSetDef ) );
+
+    sal_Int32 nFirst = pClass->nMembers - pCompType->nMembers;
+    for( sal_Int32 i = 0 ; i < pCompType->nMembers ; i ++ )
+    {
+        OString name( OUStringToOString( pCompType->ppMemberNames[i], RTL_TEXTENCODING_UTF8 ) );
+        sal_Char *pName = (sal_Char *) rtl_allocateMemory( name.getLength() + 1 );
+        memcpy( pName, name.getStr(), name.getLength() + 1 );
+
+        PyGetSetDef *pDef = &pClass->pGetSets[i];
+        pDef->name = pName;
+        pDef->get = PyUNOStruct_getMember;
+        pDef->set = PyUNOStruct_setMember;
+        pDef->closure = &pClass->pMembers[ nFirst + i ];
+    }
+    classes[ typeName ] = pClass;
+    return pClass;
+}
+
+static void releaseStructClassData( StructClass *pClass )
+{
+    if( -- pClass->nRefCount )
+        return;
+    getStructClasses().erase( OUString( pClass->pTypeDescr->pTypeName ) );
+
+    typelib_CompoundTypeDescription *pCompType =
+        reinterpret_cast< typelib_CompoundTypeDescription * >( pClass->pTypeDescr );
+    for( sal_Int32 i = 0 ; i < pCompType->nMembers ; i ++ )
+        rtl_freeMemory( const_cast< char * >( pClass->pGetSets[i].name ) );
+    delete [] pClass->pGetSets;
+    for( sal_Int32 i = 0 ; i < pClass->nMembers ; i ++ )
+    {
+        StructMember & member = pClass->pMembers[i];
+        typelib_typedescriptionreference_release( member.pTypeRef );
+        Py_DECREF( member.name );
+        Py_XDECREF( member.memberClass );
+    }
+    delete [] pClass->pMembers;
+    typelib_typedescription_release( pClass->pTypeDescr );
+    delete pClass;
+}
+
+extern "C" {
+
+static void StructClass_capsule_del( PyObject *capsule )
+{
+    releaseStructClassData(
+        static_cast< StructClass * >( PyCapsule_GetPointer( capsule, STRUCT_CLASS_CAPSULE ) ) );
+}
+
+}
+
+void addStructMembers( PyObject *dict, typelib_CompoundTypeDescription *pCompType )
+{
+    StructClass *pClass = acquireStructClassData( pCompType );
+    PyRef capsule( PyCapsule_New( pClass, STRUCT_CLASS_CAPSULE, StructClass_capsule_del ), SAL_NO_ACQUIRE );
+    if( ! capsule.is() )
+    {
+        releaseStructClassData( pClass );
+        return;
+    }
+    PyDict_SetItemString( dict, "__pyunostructclass__", capsule.get() );
+
+    // instances keep their state in the embedded UNO value only
+    PyRef slots( PyTuple_New( 0 ), SAL_NO_ACQUIRE );
+    PyDict_SetItemString( dict, "__slots__", slots.get() );
+}
+
+void addStructDescriptors( PyObject *clazz )
+{
+    if( ! PyType_Check( clazz ) )
+        return;
+    PyTypeObject *type = reinterpret_cast< PyTypeObject * >( clazz );
+    StructClass *pClass = getStructClass( type );
+    if( ! pClass )
+        return;
+    sal_Int32 nMembers = reinterpret_cast< typelib_CompoundTypeDescription * >( pClass->pTypeDescr )->nMembers;
+    for( sal_Int32 i = 0 ; i < nMembers ; i ++ )
+    {
+        PyGetSetDef *pDef = &pClass->pGetSets[i];
+        PyRef descr( PyDescr_NewGetSet( type, pDef ), SAL_NO_ACQUIRE );
+        PyDict_SetItemString( type->tp_dict, pDef->name, descr.get() );
+    }
+    PyType_Modified( type );
+}
+
+sal_Int64 getStructClassMemory( PyObject *clazz )
+{
+    if( ! PyType_Check( clazz ) )
+        return 0;
+    StructClass *pClass = getStructClass( reinterpret_cast< PyTypeObject * >( clazz ) );
+    if( ! pClass )
+        return 0;
+    typelib_CompoundTypeDescription *pCompType =
+        reinterpret_cast< typelib_CompoundTypeDescription * >( pClass->pTypeDescr );
+    return sizeof( StructClass ) + pClass->nMembers * sizeof( StructMember ) +
+        pCompType->nMembers * sizeof( PyGetSetDef );
+}
+
+}
@@ -27,6 +27,8 @@
 
 #include <typelib/typedescription.hxx>
 
+#include <structmember.h>
+
 using rtl::OString;
 using rtl::OUString;
 using rtl::OUStringBuffer;
@@ -114,19 +116,58 @@ static PyRef getClass( const Runtime & r , const char * name)
     return PyRef( PyDict_GetItemString( r.getImpl()->cargo->getUnoModule().get(), (char*) name ) );
 }
 
-PyRef getTypeClass( const Runtime & r )
+extern PyTypeObject PyUNOEnumType;
+extern PyTypeObject PyUNOTypeType;
+extern PyTypeObject PyUNOCharType;
+extern PyTypeObject PyUNOAnyType;
+
+/** uno.Enum, the value is resolved against the enum type description on
+    construction.
+*/
+typedef struct
+{
+    PyObject_HEAD
+    typelib_TypeDescriptionReference *pTypeRef;
+    sal_Int32 nValue;
+    PyObject *typeName;
+    PyObject *value;
+} PyUNOEnum;
+
+/** uno.Type, the name and type class are created on first access */
+typedef struct
+{
+    PyObject_HEAD
+    typelib_TypeDescriptionReference *pTypeRef;
+    PyObject *typeName;
+    PyObject *typeClass;
+} PyUNOType;
+
+typedef struct
 {
-    return getClass( r , "Type" );
+    PyObject_HEAD
+    sal_Unicode value;
+} PyUNOChar;
+
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *type;
+    PyObject *value;
+} PyUNOAny;
+
+PyRef getTypeClass( const Runtime & )
+{
+    return PyRef( reinterpret_cast< PyObject * >( &PyUNOTypeType ) );
 }
 
-PyRef getEnumClass( const Runtime & r )
+PyRef getEnumClass( const Runtime & )
 {
-    return getClass( r , "Enum" );
+    return PyRef( reinterpret_cast< PyObject * >( &PyUNOEnumType ) );
 }
 
-PyRef getCharClass( const Runtime & r )
+PyRef getCharClass( const Runtime & )
 {
-    return getClass( r , "Char" );
+    return PyRef( reinterpret_cast< PyObject * >( &PyUNOCharType ) );
 }
 
 PyRef getByteSequenceClass( const Runtime & r )
@@ -134,9 +175,19 @@ PyRef getByteSequenceClass( const Runtime & r )
     return getClass( r , "ByteSequence" );
 }
 
-PyRef getAnyClass( const Runtime & r )
+PyRef getSequenceABC( const Runtime & r )
 {
-    return getClass( r , "Any" );
+    return getClass( r , "_SequenceABC" );
+}
+
+PyRef getMappingABC( const Runtime & r )
+{
+    return getClass( r , "_MappingABC" );
+}
+
+PyRef getAnyClass( const Runtime & )
+{
+    return PyRef( reinterpret_cast< PyObject * >( &PyUNOAnyType ) );
 }
 
 PyRef getUNOStruct( const Runtime & r )
@@ -149,9 +200,737 @@ PyRef getUNOException( const Runtime & r )
     return getClass( r, "UNOException" );
 }
 
+/** @return the complete description of the enum typeName, throws if there is none */
+static TypeDescription getEnumDescription( const OUString & typeName )
+{
+    TypeDescription desc( typeName );
+    if( ! desc.is() )
+    {
+        OUStringBuffer buf;
+        buf.appendAscii( "enum " ).append( typeName ).appendAscii( " is unknown" );
+        throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface>  () );
+    }
+    if( desc.get()->eTypeClass != typelib_TypeClass_ENUM )
+    {
+        OUStringBuffer buf;
+        buf.appendAscii( "pyuno.checkEnum: " ).append( typeName ).appendAscii( "is a " );
+        buf.appendAscii(
+            typeClassToString( (com::sun::star::uno::TypeClass) desc.get()->eTypeClass ) );
+        buf.appendAscii( ", expected ENUM" );
+        throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface>  () );
+    }
+    desc.makeComplete();
+    return desc;
+}
+
+/** @return index of the named value in the enum, throws if it is unknown */
+static sal_Int32 findEnumName( const TypeDescription & desc, const OUString & value )
+{
+    typelib_EnumTypeDescription *pEnumDesc = (typelib_EnumTypeDescription*) desc.get();
+    for( sal_Int32 i = 0 ; i < pEnumDesc->nEnumValues ; i ++ )
+    {
+        if( *((OUString *)&pEnumDesc->ppEnumNames[i]) == value )
+            return i;
+    }
+    OUStringBuffer buf;
+    buf.appendAscii( "value " ).append( value ).appendAscii( "is unknown in enum " );
+    buf.append( OUString( desc.get()->pTypeName ) );
+    throw RuntimeException( buf.makeStringAndClear(), Reference<XInterface> () );
+}
+
+static PyObject *createEnum( PyTypeObject *type, typelib_EnumTypeDescription *pEnumDesc, sal_Int32 nIndex )
+{
+    PyUNOEnum *self = reinterpret_cast< PyUNOEnum * >( type->tp_alloc( type, 0 ) );
+    if( ! self )
+        return 0;
+    self->pTypeRef = pEnumDesc->aBase.pWeakRef;
+    typelib_typedescriptionreference_acquire( self->pTypeRef );
+    self->nValue = pEnumDesc->pEnumValues[nIndex];
+    self->typeName = ustring2PyInternedString( pEnumDesc->aBase.pTypeName ).getAcquired();
+    self->value = ustring2PyInternedString( pEnumDesc->ppEnumNames[nIndex] ).getAcquired();
+    return reinterpret_cast< PyObject * >( self );
+}
+
+static PyObject *createType( PyTypeObject *type, typelib_TypeDescriptionReference *pTypeRef )
+{
+    PyUNOType *self = reinterpret_cast< PyUNOType * >( type->tp_alloc( type, 0 ) );
+    if( ! self )
+        return 0;
+    self->pTypeRef = pTypeRef;
+    typelib_typedescriptionreference_acquire( pTypeRef );
+    return reinterpret_cast< PyObject * >( self );
+}
+
+static bool getUnicodeArgument( PyObject *arg, const char *what, OUString & ret )
+{
+#if PY_VERSION_HEX >= 0x03000000
+    if( ! PyUnicode_Check( arg ) )
+#else
+    if( ! PyUnicode_Check( arg ) && ! PyString_Check( arg ) )
+#endif
+    {
+        PyErr_Format( PyExc_TypeError, "%s must be a string", what );
+        return false;
+    }
+    ret = pyString2ustring( arg );
+    return true;
+}
+
+static PyObject *richcompareResult( bool bEqual, int op )
+{
+    PyObject *ret = ( bEqual == ( op == Py_EQ ) ) ? Py_True : Py_False;
+    Py_INCREF( ret );
+    return ret;
+}
+
+static PyObject *notImplemented()
+{
+    Py_INCREF( Py_NotImplemented );
+    return Py_NotImplemented;
+}
+
+extern "C" {
+
+static PyObject *PyUNOEnum_new( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+    static const char *kwlist[] = { "typeName", "value", 0 };
+    PyObject *pyTypeName;
+    PyObject *pyValue;
+    if( ! PyArg_ParseTupleAndKeywords( args, kwds, const_cast< char * >("OO"), const_cast< char ** >( kwlist ),
+                                       &pyTypeName, &pyValue ) )
+        return 0;
+    OUString typeName;
+    OUString value;
+    if( ! getUnicodeArgument( pyTypeName, "typeName", typeName ) ||
+        ! getUnicodeArgument( pyValue, "value", value ) )
+        return 0;
+    try
+    {
+        TypeDescription desc( getEnumDescription( typeName ) );
+        return createEnum( type, (typelib_EnumTypeDescription *) desc.get(), findEnumName( desc, value ) );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( com::sun::star::uno::makeAny( e ) );
+    }
+    return 0;
+}
+
+static void PyUNOEnum_del( PyObject *self )
+{
+    PyUNOEnum *me = reinterpret_cast< PyUNOEnum * >( self );
+    typelib_typedescriptionreference_release( me->pTypeRef );
+    Py_XDECREF( me->typeName );
+    Py_XDECREF( me->value );
+    Py_TYPE( self )->tp_free( self );
+}
+
+static PyObject *PyUNOEnum_repr( PyObject *self )
+{
+    PyUNOEnum *me = reinterpret_cast< PyUNOEnum * >( self );
+#if PY_VERSION_HEX >= 0x03000000
+    return PyUnicode_FromFormat( "<uno.Enum %U (%R)>", me->typeName, me->value );
+#else
+    return PyString_FromFormat( "<uno.Enum %s ('%s')>",
+                                PyString_AsString( me->typeName ), PyString_AsString( me->value ) );
+#endif
+}
+
+static Py_hash_t PyUNOEnum_hash( PyObject *self )
+{
+    PyUNOEnum *me = reinterpret_cast< PyUNOEnum * >( self );
+    Py_hash_t ret = PyObject_Hash( me->typeName ) ^ PyObject_Hash( me->value );
+    return ret == -1 ? -2 : ret;
+}
+
+static PyObject *PyUNOEnum_richcompare( PyObject *self, PyObject *that, int op )
+{
+    if( ( op != Py_EQ && op != Py_NE ) || ! PyObject_TypeCheck( that, &PyUNOEnumType ) )
+        return notImplemented();
+    PyUNOEnum *me = reinterpret_cast< PyUNOEnum * >( self );
+    PyUNOEnum *other = reinterpret_cast< PyUNOEnum * >( that );
+    return richcompareResult(
+        me->nValue == other->nValue &&
+        typelib_typedescriptionreference_equals( me->pTypeRef, other->pTypeRef ), op );
+}
+
+static PyObject *PyUNOType_new( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+    static const char *kwlist[] = { "typeName", "typeClass", 0 };
+    PyObject *pyTypeName;
+    PyObject *pyTypeClass;
+    if( ! PyArg_ParseTupleAndKeywords( args, kwds, const_cast< char * >("OO"), const_cast< char ** >( kwlist ),
+                                       &pyTypeName, &pyTypeClass ) )
+        return 0;
+    OUString name;
+    if( ! getUnicodeArgument( pyTypeName, "typeName", name ) )
+        return 0;
+    try
+    {
+        Any enumValue = PyEnum2Enum( pyTypeClass );
+        TypeDescription desc( name );
+        if( ! desc.is() )
+        {
+            OUStringBuffer buf;
+            buf.appendAscii( "type " ).append(name).appendAscii( " is unknown" );
+            throw RuntimeException(
+                buf.makeStringAndClear(), Reference< XInterface > () );
+        }
+        if( desc.get()->eTypeClass != (typelib_TypeClass) *(sal_Int32*)enumValue.getValue() )
+        {
+            OUStringBuffer buf;
+            buf.appendAscii( "pyuno.checkType: " ).append(name).appendAscii( " is a " );
+            buf.appendAscii( typeClassToString( (TypeClass) desc.get()->eTypeClass) );
+            buf.appendAscii( ", but type got construct with typeclass " );
+            buf.appendAscii( typeClassToString( (TypeClass) *(sal_Int32*)enumValue.getValue() ) );
+            throw RuntimeException(
+                buf.makeStringAndClear(), Reference< XInterface > () );
+        }
+        return createType( type, desc.get()->pWeakRef );
+    }
+    catch( RuntimeException & e )
+    {
+        raisePyExceptionWithAny( com::sun::star::uno::makeAny( e ) );
+    }
+    return 0;
+}
+
+static void PyUNOType_del( PyObject *self )
+{
+    PyUNOType *me = reinterpret_cast< PyUNOType * >( self );
+    typelib_typedescriptionreference_release( me->pTypeRef );
+    Py_XDECREF( me->typeName );
+    Py_XDECREF( me->typeClass );
+    Py_TYPE( self )->tp_free( self );
+}
+
+static PyObject *PyUNOType_getTypeName( PyObject *self, void * )
+{
+    PyUNOType *me = reinterpret_cast< PyUNOType * >( self );
+    if( ! me->typeName )
+        me->typeName = ustring2PyInternedString( me->pTypeRef->pTypeName ).getAcquired();
+    Py_XINCREF( me->typeName );
+    return me->typeName;
+}
+
+static PyObject *PyUNOType_getTypeClass( PyObject *self, void * )
+{
+    PyUNOType *me = reinterpret_cast< PyUNOType * >( self );
+    if( ! me->typeClass )
+    {
+        try
+        {
+            me->typeClass = PyUNO_Enum_fromValue(
+                getCppuType( (TypeClass *) 0 ).getTypeLibType(), me->pTypeRef->eTypeClass );
+        }
+        catch( RuntimeException & e )
+        {
+            raisePyExceptionWithAny( com::sun::star::uno::makeAny( e ) );
+        }
+    }
+    Py_XINCREF( me->typeClass );
+    return me->typeClass;
+}
+
+static PyObject *PyUNOType_repr( PyObject *self )
+{
+    PyRef typeName( PyUNOType_getTypeName( self, 0 ), SAL_NO_ACQUIRE );
+    PyRef typeClass( PyUNOType_getTypeClass( self, 0 ), SAL_NO_ACQUIRE );
+    if( ! typeName.is() || ! typeClass.is() )
+        return 0;
+#if PY_VERSION_HEX >= 0x03000000
+    return PyUnicode_FromFormat( "<Type instance %U (%R)>", typeName.get(), typeClass.get() );
+#else
+    PyRef typeClassRepr( PyObject_Repr( typeClass.get() ), SAL_NO_ACQUIRE );
+    if( ! typeClassRepr.is() )
+        return 0;
+    return PyString_FromFormat( "<Type instance %s (%s)>",
+                                PyString_AsString( typeName.get() ),
+                                PyString_AsString( typeClassRepr.get() ) );
+#endif
+}
+
+static Py_hash_t PyUNOType_hash( PyObject *self )
+{
+    PyRef typeName( PyUNOType_getTypeName( self, 0 ), SAL_NO_ACQUIRE );
+    if( ! typeName.is() )
+        return -1;
+    return PyObject_Hash( typeName.get() );
+}
+
+static PyObject *PyUNOType_richcompare( PyObject *self, PyObject *that, int op )
+{
+    if( ( op != Py_EQ && op != Py_NE ) || ! PyObject_TypeCheck( that, &PyUNOTypeType ) )
+        return notImplemented();
+    return richcompareResult(
+        typelib_typedescriptionreference_equals(
+            reinterpret_cast< PyUNOType * >( self )->pTypeRef,
+            reinterpret_cast< PyUNOType * >( that )->pTypeRef ), op );
+}
+
+static PyObject *PyUNOChar_new( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+    static const char *kwlist[] = { "value", 0 };
+    PyObject *value;
+    if( ! PyArg_ParseTupleAndKeywords( args, kwds, const_cast< char * >("O"), const_cast< char ** >( kwlist ), &value ) )
+        return 0;
+#if PY_VERSION_HEX >= 0x03030000
+    if( ! PyUnicode_Check( value ) || PyUnicode_GetLength( value ) != 1 )
+#else
+    if( ! PyUnicode_Check( value ) || PyUnicode_GetSize( value ) != 1 )
+#endif
+    {
+        PyErr_SetString( PyExc_TypeError, "uno.Char expects a string of length 1" );
+        return 0;
+    }
+    PyUNOChar *self = reinterpret_cast< PyUNOChar * >( type->tp_alloc( type, 0 ) );
+    if( ! self )
+        return 0;
+#if PY_VERSION_HEX >= 0x03030000
+    // Out of BMP lost its data
+    self->value = (sal_Unicode)PyUnicode_ReadChar( value, 0 );
+#else
+    self->value = (sal_Unicode)PyUnicode_AsUnicode( value )[0];
+#endif
+    return reinterpret_cast< PyObject * >( self );
+}
+
+static void PyUNOChar_del( PyObject *self )
+{
+    Py_TYPE( self )->tp_free( self );
+}
+
+static PyObject *PyUNOChar_getValue( PyObject *self, void * )
+{
+    PyUNOChar *me = reinterpret_cast< PyUNOChar * >( self );
+#if PY_VERSION_HEX >= 0x03030000
+    Py_UCS2 u[1];
+    u[0] = me->value;
+    return PyUnicode_FromKindAndData( PyUnicode_2BYTE_KIND, u, 1 );
+#else
+    Py_UNICODE u[2];
+    u[0] = me->value;
+    u[1] = 0;
+    return PyUnicode_FromUnicode( u, 1 );
+#endif
+}
+
+static PyObject *PyUNOChar_repr( PyObject *self )
+{
+    PyRef value( PyUNOChar_getValue( self, 0 ), SAL_NO_ACQUIRE );
+    if( ! value.is() )
+        return 0;
+#if PY_VERSION_HEX >= 0x03000000
+    return PyUnicode_FromFormat( "<Char instance %U>", value.get() );
+#else
+    PyRef str( PyUnicode_AsUTF8String( value.get() ), SAL_NO_ACQUIRE );
+    if( ! str.is() )
+        return 0;
+    return PyString_FromFormat( "<Char instance %s>", PyString_AsString( str.get() ) );
+#endif
+}
+
+/** hashes like the string of the character, which compares equal */
+static Py_hash_t PyUNOChar_hash( PyObject *self )
+{
+    PyRef value( PyUNOChar_getValue( self, 0 ), SAL_NO_ACQUIRE );
+    if( ! value.is() )
+        return -1;
+    return PyObject_Hash( value.get() );
+}
+
+static PyObject *PyUNOChar_richcompare( PyObject *self, PyObject *that, int op )
+{
+    if( op != Py_EQ && op != Py_NE )
+        return notImplemented();
+    sal_Unicode c = reinterpret_cast< PyUNOChar * >( self )->value;
+    if( PyObject_TypeCheck( that, &PyUNOCharType ) )
+        return richcompareResult( c == reinterpret_cast< PyUNOChar * >( that )->value, op );
+    if( PyUnicode_Check( that ) )
+    {
+#if PY_VERSION_HEX >= 0x03030000
+        return richcompareResult(
+            PyUnicode_GetLength( that ) == 1 && (sal_Unicode)PyUnicode_ReadChar( that, 0 ) == c, op );
+#else
+        return richcompareResult(
+            PyUnicode_GetSize( that ) == 1 && (sal_Unicode)PyUnicode_AsUnicode( that )[0] == c, op );
+#endif
+    }
+    return notImplemented();
+}
+
+static PyObject *PyUNOAny_new( PyTypeObject *type, PyObject *args, PyObject *kwds )
+{
+    static const char *kwlist[] = { "type", "value", 0 };
+    PyObject *pyType;
+    PyObject *value;
+    if( ! PyArg_ParseTupleAndKeywords( args, kwds, const_cast< char * >("OO"), const_cast< char ** >( kwlist ),
+                                       &pyType, &value ) )
+        return 0;
+    PyRef unoType( pyType );
+    if( ! PyObject_TypeCheck( pyType, &PyUNOTypeType ) )
+    {
+        OUString name;
+        if( ! getUnicodeArgument( pyType, "type", name ) )
+            return 0;
+        TypeDescription desc( name );
+        if( ! desc.is() )
+        {
+            OUStringBuffer buf;
+            buf.appendAscii( "type " ).append( name ).appendAscii( " is unknown" );
+            raisePyExceptionWithAny( com::sun::star::uno::makeAny(
+                RuntimeException( buf.makeStringAndClear(), Reference< XInterface > () ) ) );
+            return 0;
+        }
+        unoType = PyRef( createType( &PyUNOTypeType, desc.get()->pWeakRef ), SAL_NO_ACQUIRE );
+        if( ! unoType.is() )
+            return 0;
+    }
+    PyUNOAny *self = reinterpret_cast< PyUNOAny * >( type->tp_alloc( type, 0 ) );
+    if( ! self )
+        return 0;
+    self->type = unoType.getAcquired();
+    Py_INCREF( value );
+    self->value = value;
+    return reinterpret_cast< PyObject * >( self );
+}
+
+static int PyUNOAny_traverse( PyObject *self, visitproc visit, void *arg )
+{
+    PyUNOAny *me = reinterpret_cast< PyUNOAny * >( self );
+    Py_VISIT( me->type );
+    Py_VISIT( me->value );
+    return 0;
+}
+
+static int PyUNOAny_clear( PyObject *self )
+{
+    PyUNOAny *me = reinterpret_cast< PyUNOAny * >( self );
+    Py_CLEAR( me->type );
+    Py_CLEAR( me->value );
+    return 0;
+}
+
+static void PyUNOAny_del( PyObject *self )
+{
+    PyObject_GC_UnTrack( self );
+    PyUNOAny_clear( self );
+    Py_TYPE( self )->tp_free( self );
+}
+
+}
+
+/** __reduce__ of the value types, they are pickled and copied by calling the
+    type with the constructor arguments again
+*/
+static PyObject *reduceValue( PyObject *self, PyObject *first, PyObject *second = 0 )
+{
+    if( ! first )
+        return 0;
+    if( second )
+        return Py_BuildValue( "O(OO)", Py_TYPE( self ), first, second );
+    return Py_BuildValue( "O(O)", Py_TYPE( self ), first );
+}
+
+extern "C" {
+
+static PyObject *PyUNOEnum_reduce( PyObject *self, PyObject * )
+{
+    PyUNOEnum *me = reinterpret_cast< PyUNOEnum * >( self );
+    return reduceValue( self, me->typeName, me->value );
+}
+
+static PyObject *PyUNOType_reduce( PyObject *self, PyObject * )
+{
+    PyRef typeName( PyUNOType_getTypeName( self, 0 ), SAL_NO_ACQUIRE );
+    PyRef typeClass( PyUNOType_getTypeClass( self, 0 ), SAL_NO_ACQUIRE );
+    if( ! typeName.is() || ! typeClass.is() )
+        return 0;
+    return reduceValue( self, typeName.get(), typeClass.get() );
+}
+
+static PyObject *PyUNOChar_reduce( PyObject *self, PyObject * )
+{
+    PyRef value( PyUNOChar_getValue( self, 0 ), SAL_NO_ACQUIRE );
+    return reduceValue( self, value.get() );
+}
+
+static PyObject *PyUNOAny_reduce( PyObject *self, PyObject * )
+{
+    PyUNOAny *me = reinterpret_cast< PyUNOAny * >( self );
+    return reduceValue( self, me->type, me->value );
+}
+
+}
+
+static PyMethodDef PyUNOEnum_methods[] =
+{
+    { "__reduce__", PyUNOEnum_reduce, METH_NOARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMethodDef PyUNOType_methods[] =
+{
+    { "__reduce__", PyUNOType_reduce, METH_NOARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMethodDef PyUNOChar_methods[] =
+{
+    { "__reduce__", PyUNOChar_reduce, METH_NOARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMethodDef PyUNOAny_methods[] =
+{
+    { "__reduce__", PyUNOAny_reduce, METH_NOARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMemberDef PyUNOEnum_members[] =
+{
+    { const_cast< char * >("typeName"), T_OBJECT, offsetof( PyUNOEnum, typeName ), READONLY, NULL },
+    { const_cast< char * >("value"), T_OBJECT, offsetof( PyUNOEnum, value ), READONLY, NULL },
+    { NULL, 0, 0, 0, NULL }
+};
+
+static PyGetSetDef PyUNOType_getset[] =
+{
+    { const_cast< char * >("typeName"), PyUNOType_getTypeName, NULL, NULL, NULL },
+    { const_cast< char * >("typeClass"), PyUNOType_getTypeClass, NULL, NULL, NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyGetSetDef PyUNOChar_getset[] =
+{
+    { const_cast< char * >("value"), PyUNOChar_getValue, NULL, NULL, NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyMemberDef PyUNOAny_members[] =
+{
+    { const_cast< char * >("type"), T_OBJECT, offsetof( PyUNOAny, type ), READONLY, NULL },
+    { const_cast< char * >("value"), T_OBJECT, offsetof( PyUNOAny, value ), READONLY, NULL },
+    { NULL, 0, 0, 0, NULL }
+};
+
+PyTypeObject PyUNOEnumType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.Enum"), /* tp_name */
+    sizeof (PyUNOEnum), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOEnum_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) PyUNOEnum_repr, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) PyUNOEnum_hash, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) 0, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    const_cast< char * >("Represents a UNO idl enum value"), /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    PyUNOEnum_richcompare, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) 0, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    PyUNOEnum_methods, /* tp_methods */
+    PyUNOEnum_members, /* tp_members */
+    NULL, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) 0, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) PyUNOEnum_new, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+PyTypeObject PyUNOTypeType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.Type"), /* tp_name */
+    sizeof (PyUNOType), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOType_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) PyUNOType_repr, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) PyUNOType_hash, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) 0, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    const_cast< char * >("Represents a UNO type"), /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    PyUNOType_richcompare, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) 0, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    PyUNOType_methods, /* tp_methods */
+    NULL, /* tp_members */
+    PyUNOType_getset, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) 0, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) PyUNOType_new, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+PyTypeObject PyUNOCharType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.Char"), /* tp_name */
+    sizeof (PyUNOChar), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOChar_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) PyUNOChar_repr, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) PyUNOChar_hash, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) 0, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    const_cast< char * >("Represents a UNO char, use an instance of this class to explicitly pass a char to UNO"), /* tp_doc */
+    (traverseproc) 0, /* tp_traverse */
+    (inquiry) 0, /* tp_clear */
+    PyUNOChar_richcompare, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) 0, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    PyUNOChar_methods, /* tp_methods */
+    NULL, /* tp_members */
+    PyUNOChar_getset, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) 0, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) PyUNOChar_new, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
+
+PyTypeObject PyUNOAnyType =
+{
+    PyVarObject_HEAD_INIT( &PyType_Type, 0 )
+    const_cast< char * >("uno.Any"), /* tp_name */
+    sizeof (PyUNOAny), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor) PyUNOAny_del, /* tp_dealloc */
+    (printfunc) 0, /* tp_print */
+    (getattrfunc) 0, /* tp_getattr */
+    (setattrfunc) 0, /* tp_setattr */
+    0, /* tp_reserved */
+    (reprfunc) 0, /* tp_repr */
+    0, /* tp_as_number */
+    0, /* tp_as_sequence */
+    0, /* tp_as_mapping */
+    (hashfunc) 0, /* tp_hash */
+    (ternaryfunc) 0, /* tp_call */
+    (reprfunc) 0, /* tp_str */
+    (getattrofunc) 0, /* tp_getattro */
+    (setattrofunc) 0, /* tp_setattro */
+    NULL, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    const_cast< char * >("use only in connection with uno.invoke() to pass an explicit typed any"), /* tp_doc */
+    (traverseproc) PyUNOAny_traverse, /* tp_traverse */
+    (inquiry) PyUNOAny_clear, /* tp_clear */
+    (richcmpfunc) 0, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    (getiterfunc) 0, /* tp_iter */
+    (iternextfunc) 0, /* tp_iternext */
+    PyUNOAny_methods, /* tp_methods */
+    PyUNOAny_members, /* tp_members */
+    NULL, /* tp_getset */
+    NULL, /* tp_base */
+    NULL, /* tp_dict */
+    (descrgetfunc) 0, /* tp_descr_get */
+    (descrsetfunc) 0, /* tp_descr_set */
+    0, /* tp_dictoffset */
+    (initproc) 0, /* tp_init */
+    (allocfunc) 0, /* tp_alloc */
+    (newfunc) PyUNOAny_new, /* tp_new */
+    (freefunc) 0, /* tp_free */
+    (inquiry) 0, /* tp_is_gc */
+    NULL, /* tp_bases */
+    NULL, /* tp_mro */
+    NULL, /* tp_cache */
+    NULL, /* tp_subclasses */
+    NULL, /* tp_weaklist */
+    (destructor) 0 /* tp_del */
+#if PY_VERSION_HEX >= 0x02060000
+    , 0 /* tp_version_tag */
+#endif
+};
 
 sal_Unicode PyChar2Unicode( PyObject *obj ) throw ( RuntimeException )
 {
+    if( PyObject_TypeCheck( obj, &PyUNOCharType ) )
+        return reinterpret_cast< PyUNOChar * >( obj )->value;
+
     PyRef value( PyObject_GetAttrString( obj, const_cast< char * >("value") ), SAL_NO_ACQUIRE );
 
     if( ! PyUnicode_Check( value.get() ) )
@@ -161,7 +940,11 @@ sal_Unicode PyChar2Unicode( PyObject *obj ) throw ( RuntimeException )
             Reference< XInterface > () );
     }
 
+#if PY_VERSION_HEX >= 0x03030000
+    if( PyUnicode_GetLength( value.get() ) < 1 )
+#else
     if( PyUnicode_GetSize( value.get() ) < 1 )
+#endif
     {
         throw RuntimeException(
             USTR_ASCII( "uno.Char contains an empty unicode string" ),
@@ -179,7 +962,12 @@ sal_Unicode PyChar2Unicode( PyObject *obj ) throw ( RuntimeException )
 
 Any PyEnum2Enum( PyObject *obj ) throw ( RuntimeException )
 {
-    Any ret;
+    if( PyObject_TypeCheck( obj, &PyUNOEnumType ) )
+    {
+        PyUNOEnum *me = reinterpret_cast< PyUNOEnum * >( obj );
+        return Any( &me->nValue, me->pTypeRef );
+    }
+
     PyRef typeName( PyObject_GetAttrString( obj,const_cast< char * >("typeName") ), SAL_NO_ACQUIRE);
     PyRef value( PyObject_GetAttrString( obj, const_cast< char * >("value") ), SAL_NO_ACQUIRE);
 #if PY_VERSION_HEX > 0x03000000
@@ -192,72 +980,19 @@ Any PyEnum2Enum( PyObject *obj ) throw ( RuntimeException )
             USTR_ASCII( "attributes typeName and/or value of uno.Enum are not strings" ),
             Reference< XInterface > () );
     }
-    
-#if PY_VERSION_HEX >= 0x03030000
-    OUString strTypeName( OUString::createFromAscii( PyUnicode_AsUTF8( typeName.get() ) ) );
-#else
-    OUString strTypeName( OUString::createFromAscii( PyString_AsString( typeName.get() ) ) );
-#endif
-    
-#if PY_VERSION_HEX >= 0x03030000
-    char *stringValue = PyUnicode_AsUTF8( value.get() );
-#else
-    char *stringValue = PyString_AsString( value.get() );
-#endif
 
-    TypeDescription desc( strTypeName );
-    if( desc.is() )
-    {
-        if(desc.get()->eTypeClass != typelib_TypeClass_ENUM )
-        {
-            OUStringBuffer buf;
-            buf.appendAscii( "pyuno.checkEnum: " ).append(strTypeName).appendAscii( "is a " );
-            buf.appendAscii(
-                typeClassToString( (com::sun::star::uno::TypeClass) desc.get()->eTypeClass));
-            buf.appendAscii( ", expected ENUM" );
-            throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface>  () );
-        }
-           
-        desc.makeComplete();
-        
-        typelib_EnumTypeDescription *pEnumDesc = (typelib_EnumTypeDescription*) desc.get();
-        int i = 0;
-        for( i = 0; i < pEnumDesc->nEnumValues ; i ++ )
-        {
-            if( (*((OUString *)&pEnumDesc->ppEnumNames[i])).compareToAscii( stringValue ) == 0 )
-            {
-                break;
-            }
-        }
-        if( i == pEnumDesc->nEnumValues )
-        {
-            OUStringBuffer buf;
-            buf.appendAscii( "value " ).appendAscii( stringValue ).appendAscii( "is unknown in enum " );
-#if PY_VERSION_HEX >= 0x03030000
-            buf.appendAscii( PyUnicode_AsUTF8( typeName.get() ) );
-#else
-            buf.appendAscii( PyString_AsString( typeName.get() ) );
-#endif
-            throw RuntimeException( buf.makeStringAndClear(), Reference<XInterface> () );
-        }
-        ret = Any( &pEnumDesc->pEnumValues[i], desc.get()->pWeakRef );
-    }
-    else
-    {
-        OUStringBuffer buf;
-#if PY_VERSION_HEX >= 0x03030000
-        buf.appendAscii( "enum " ).appendAscii( PyUnicode_AsUTF8(typeName.get()) ).appendAscii( " is unknown" );
-#else
-        buf.appendAscii( "enum " ).appendAscii( PyString_AsString(typeName.get()) ).appendAscii( " is unknown" );
-#endif
-        throw RuntimeException( buf.makeStringAndClear(), Reference< XInterface>  () );
-    }
-    return ret;
+    TypeDescription desc( getEnumDescription( pyString2ustring( typeName.get() ) ) );
+    typelib_EnumTypeDescription *pEnumDesc = (typelib_EnumTypeDescription*) desc.get();
+    sal_Int32 i = findEnumName( desc, pyString2ustring( value.get() ) );
+    return Any( &pEnumDesc->pEnumValues[i], desc.get()->pWeakRef );
 }
 
 
 Type PyType2Type( PyObject * o ) throw(RuntimeException )
 {
+    if( PyObject_TypeCheck( o, &PyUNOTypeType ) )
+        return Type( reinterpret_cast< PyUNOType * >( o )->pTypeRef );
+
     PyRef pyName( PyObject_GetAttrString( o, const_cast< char * >("typeName") ), SAL_NO_ACQUIRE);
 #if PY_VERSION_HEX > 0x03000000
     if( !PyUnicode_Check( pyName.get() ) )
@@ -273,11 +1008,7 @@ Type PyType2Type( PyObject * o ) throw(RuntimeException )
     PyRef pyTC( PyObject_GetAttrString( o, const_cast< char * >("typeClass") ), SAL_NO_ACQUIRE );
     Any enumValue = PyEnum2Enum( pyTC.get() );
 
-#if PY_VERSION_HEX >= 0x03030000
-    OUString name( OUString::createFromAscii( PyUnicode_AsUTF8( pyName.get() ) ) );
-#else
-    OUString name( OUString::createFromAscii( PyString_AsString( pyName.get() ) ) );
-#endif
+    OUString name( pyString2ustring( pyName.get() ) );
     TypeDescription desc( name );
     if( ! desc.is() )
     {
@@ -420,74 +1151,91 @@ PyObject *importToGlobal(PyObject *str, PyObject *dict, PyObject *target)
     return ret;
 }
 
-static PyObject* callCtor( const Runtime &r , const char * clazz, const PyRef & args )
+PyObject *PyUNO_Enum_new( const char *enumBase, const char *enumValue, const Runtime & )
 {
-    PyRef code( PyDict_GetItemString( r.getImpl()->cargo->getUnoModule().get(), (char*)clazz ) );
-    if( ! code.is() )
+    TypeDescription desc( getEnumDescription( OUString::createFromAscii( enumBase ) ) );
+    return createEnum( &PyUNOEnumType, (typelib_EnumTypeDescription *) desc.get(),
+                       findEnumName( desc, OUString::createFromAscii( enumValue ) ) );
+}
+
+PyObject *PyUNO_Enum_fromValue( typelib_TypeDescriptionReference *pTypeRef, sal_Int32 nValue )
+{
+    TypeDescription desc( pTypeRef );
+    if( desc.is() )
     {
-        OStringBuffer buf;
-        buf.append( "couldn't access uno." );
-        buf.append( clazz );
-        PyErr_SetString( PyExc_RuntimeError, buf.getStr() );
-        return NULL;
+        desc.makeComplete();
+        typelib_EnumTypeDescription *pEnumDesc = (typelib_EnumTypeDescription *) desc.get();
+        for( sal_Int32 i = 0 ; i < pEnumDesc->nEnumValues ; i ++ )
+        {
+            if( pEnumDesc->pEnumValues[i] == nValue )
+                return createEnum( &PyUNOEnumType, pEnumDesc, i );
+        }
     }
-    PyRef instance( PyObject_CallObject( code.get(), args.get()  ), SAL_NO_ACQUIRE);
-    Py_XINCREF( instance.get() );
-    return instance.get();
-    
+    OUStringBuffer buf;
+    buf.appendAscii( "Any carries enum " );
+    buf.append( OUString( pTypeRef->pTypeName ) );
+    buf.appendAscii( " with invalid value " ).append( nValue );
+    throw RuntimeException( buf.makeStringAndClear() , Reference< XInterface > ()  );
 }
 
-
-PyObject *PyUNO_Enum_new( const char *enumBase, const char *enumValue, const Runtime &r )
+PyObject *PyUNO_Enum_fromIndex( typelib_EnumTypeDescription *pEnumDesc, sal_Int32 nIndex )
 {
-    PyRef args( PyTuple_New( 2 ), SAL_NO_ACQUIRE );
-#if PY_VERSION_HEX > 0x03000000
-    PyTuple_SetItem( args.get() , 0 , PyUnicode_FromString( enumBase ) );
-    PyTuple_SetItem( args.get() , 1 , PyUnicode_FromString( enumValue ) );
-#else
-    PyTuple_SetItem( args.get() , 0 , PyString_FromString( enumBase ) );
-    PyTuple_SetItem( args.get() , 1 , PyString_FromString( enumValue ) );
-#endif
-
-    return callCtor( r, "Enum" , args );
+    return createEnum( &PyUNOEnumType, pEnumDesc, nIndex );
 }
 
-
-PyObject* PyUNO_Type_new (const char *typeName , TypeClass t , const Runtime &r )
+PyObject* PyUNO_Type_new (const char *typeName , TypeClass t , const Runtime & )
 {
-    // retrieve type object
-    PyRef args( PyTuple_New( 2 ), SAL_NO_ACQUIRE );
+    typelib_TypeDescriptionReference *pTypeRef = 0;
+    typelib_typedescriptionreference_new(
+        &pTypeRef, (typelib_TypeClass) t, OUString::createFromAscii( typeName ).pData );
+    PyObject *ret = createType( &PyUNOTypeType, pTypeRef );
+    typelib_typedescriptionreference_release( pTypeRef );
+    return ret;
+}
 
-#if PY_VERSION_HEX > 0x03000000
-    PyTuple_SetItem( args.get() , 0 , PyUnicode_FromString( typeName ) );
-#else
-    PyTuple_SetItem( args.get() , 0 , PyString_FromString( typeName ) );
-#endif
-    PyObject *typeClass = PyUNO_Enum_new( "com.sun.star.uno.TypeClass" , typeClassToString(t), r );
-    if( ! typeClass )
-        return NULL;
-    PyTuple_SetItem( args.get() , 1 , typeClass);
-    
-    return callCtor( r, "Type" , args );
+PyObject *PyUNO_Type_fromRef( typelib_TypeDescriptionReference *pTypeRef )
+{
+    return createType( &PyUNOTypeType, pTypeRef );
 }
 
-PyObject* PyUNO_char_new ( sal_Unicode val , const Runtime &r ) 
+PyObject* PyUNO_char_new ( sal_Unicode val , const Runtime & )
 {
-    // retrieve type object
-    PyRef args( PyTuple_New( 1 ), SAL_NO_ACQUIRE );
+    PyUNOChar *self = PyObject_New( PyUNOChar, &PyUNOCharType );
+    if( self )
+        self->value = val;
+    return reinterpret_cast< PyObject * >( self );
+}
 
-#if PY_VERSION_HEX >= 0x03030000
-    Py_UCS2 u[1];
-    u[0] = val;
-    PyTuple_SetItem( args.get(), 0, PyUnicode_FromKindAndData( PyUnicode_2BYTE_KIND, u, 1 ) );
-#else
-    Py_UNICODE u[2];
-    u[0] = val;
-    u[1] = 0;
-    PyTuple_SetItem( args.get() , 0 , PyUnicode_FromUnicode( u ,1) );
-#endif
+bool initValueTypes( PyObject *module )
+{
+    if( PyType_Ready( &PyUNOEnumType ) < 0 || PyType_Ready( &PyUNOTypeType ) < 0 ||
+        PyType_Ready( &PyUNOCharType ) < 0 || PyType_Ready( &PyUNOAnyType ) < 0 )
+        return false;
+    Py_INCREF( &PyUNOEnumType );
+    Py_INCREF( &PyUNOTypeType );
+    Py_INCREF( &PyUNOCharType );
+    Py_INCREF( &PyUNOAnyType );
+    return PyModule_AddObject( module, "Enum", (PyObject *) &PyUNOEnumType ) == 0 &&
+        PyModule_AddObject( module, "Type", (PyObject *) &PyUNOTypeType ) == 0 &&
+        PyModule_AddObject( module, "Char", (PyObject *) &PyUNOCharType ) == 0 &&
+        PyModule_AddObject( module, "Any", (PyObject *) &PyUNOAnyType ) == 0;
+}
 
-    return callCtor( r, "Char" , args );
+static PyObject* callCtor( const Runtime &r , const char * clazz, const PyRef & args )
+{
+    PyRef code( PyDict_GetItemString( r.getImpl()->cargo->getUnoModule().get(), (char*)clazz ) );
+    if( ! code.is() )
+    {
+        OStringBuffer buf;
+        buf.append( "couldn't access uno." );
+        buf.append( clazz );
+        PyErr_SetString( PyExc_RuntimeError, buf.getStr() );
+        return NULL;
+    }
+    PyRef instance( PyObject_CallObject( code.get(), args.get()  ), SAL_NO_ACQUIRE);
+    Py_XINCREF( instance.get() );
+    return instance.get();
+    
 }
 
 PyObject *PyUNO_ByteSequence_new(
@@ -0,0 +1,635 @@
+/**************************************************************
+ * 
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ * 
+ *************************************************************/
+
+
+#include "pyuno_impl.hxx"
+
+#include <string.h>
+
+#include <osl/file.hxx>
+#include <osl/process.h>
+#include <osl/security.hxx>
+#include <rtl/bootstrap.hxx>
+#include <rtl/strbuf.hxx>
+#include <rtl/ustrbuf.hxx>
+
+#include <com/sun/star/reflection/XTypeDescriptionEnumerationAccess.hpp>
+#include <com/sun/star/reflection/XConstantsTypeDescription.hpp>
+#include <com/sun/star/reflection/XEnumTypeDescription.hpp>
+#include <com/sun/star/reflection/XStructTypeDescription.hpp>
+
+using rtl::OString;
+using rtl::OStringBuffer;
+using rtl::OUString;
+using rtl::OUStringBuffer;
+using rtl::OUStringToOString;
+
+using com::sun::star::uno::Any;
+using com::sun::star::uno::Reference;
+using com::sun::star::uno::Sequence;
+using com::sun::star::uno::TypeClass;
+using com::sun::star::uno::UNO_QUERY;
+using com::sun::star::uno::RuntimeException;
+using com::sun::star::reflection::XTypeDescription;
+using com::sun::star::reflection::XTypeDescriptionEnumeration;
+using com::sun::star::reflection::XTypeDescriptionEnumerationAccess;
+using com::sun::star::reflection::XConstantsTypeDescription;
+using com::sun::star::reflection::XConstantTypeDescription;
+using com::sun::star::reflection::XEnumTypeDescription;
+using com::sun::star::reflection::XStructTypeDescription;
+
+#define USTR_ASCII(x) OUString( RTL_CONSTASCII_USTRINGPARAM( x ) )
+
+namespace pyuno
+{
+
+namespace {
+
+// layout of the index file, native byte order:
+// header, sources, hash buckets, entries and the string pool
+struct IndexHeader
+{
+    sal_Char magic[8];
+    sal_uInt32 nSources;
+    sal_uInt32 nBuckets;        // power of two
+    sal_uInt32 nEntries;
+    sal_uInt32 nStringSize;
+};
+
+/** a type library the index has been built from */
+struct IndexSource
+{
+    sal_uInt32 url;             // offset in the string pool
+    sal_uInt32 reserved;
+    sal_uInt64 modifyTime;
+    sal_uInt64 size;
+};
+
+const sal_Char INDEX_MAGIC[8] = { 'P', 'Y', 'U', 'N', 'O', 'T', 'I', '1' };
+
+sal_uInt32 hashName( const sal_Char *name, sal_Int32 length )
+{
+    // FNV-1a, the value is stored in the file and must never change
+    sal_uInt32 hash = 2166136261U;
+    for( sal_Int32 i = 0 ; i < length ; i ++ )
+    {
+        hash ^= (sal_uInt8) name[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/** an entity collected from the type manager */
+struct BuildEntry
+{
+    OString name;
+    TypeIndexEntry entry;
+    sal_uInt32 lastChild;
+};
+
+class IndexBuilder
+{
+    ::std::vector< BuildEntry > maEntries;
+    ::std::hash_map< OString, sal_uInt32, rtl::OStringHash > maNames;
+
+public:
+    void add( const OUString & name, TypeClass typeClass, sal_uInt16 flags,
+              TypeClass valueTypeClass, sal_Int64 value );
+    void build( const Reference< XTypeDescriptionEnumeration > & xEnum );
+    void write( ::std::vector< sal_Char > & data,
+                const ::std::vector< OString > & sources,
+                const ::std::vector< IndexSource > & sourceStates );
+};
+
+void IndexBuilder::add(
+    const OUString & name, TypeClass typeClass, sal_uInt16 flags,
+    TypeClass valueTypeClass, sal_Int64 value )
+{
+    OString utf8Name( OUStringToOString( name, RTL_TEXTENCODING_UTF8 ) );
+    if( maNames.find( utf8Name ) != maNames.end() )
+        return;
+
+    BuildEntry e;
+    e.name = utf8Name;
+    memset( &e.entry, 0, sizeof( e.entry ) );
+    e.entry.nameLength = utf8Name.getLength();
+    e.entry.hash = hashName( utf8Name.getStr(), utf8Name.getLength() );
+    e.entry.nextInBucket = TYPEINDEX_NO_ENTRY;
+    e.entry.firstChild = TYPEINDEX_NO_ENTRY;
+    e.entry.nextSibling = TYPEINDEX_NO_ENTRY;
+    e.entry.typeClass = sal::static_int_cast< sal_uInt16 >( typeClass );
+    e.entry.flags = flags;
+    e.entry.valueTypeClass = sal::static_int_cast< sal_uInt16 >( valueTypeClass );
+    e.entry.value = value;
+    e.lastChild = TYPEINDEX_NO_ENTRY;
+
+    maNames[ utf8Name ] = maEntries.size();
+    maEntries.push_back( e );
+}
+
+sal_Int64 constantValue( const Any & value, TypeClass & valueTypeClass )
+{
+    sal_Int64 ret = 0;
+    valueTypeClass = value.getValueTypeClass();
+    switch( valueTypeClass )
+    {
+    case com::sun::star::uno::TypeClass_BOOLEAN:
+    {
+        sal_Bool b = sal_False;
+        value >>= b;
+        ret = b;
+        break;
+    }
+    case com::sun::star::uno::TypeClass_FLOAT:
+    case com::sun::star::uno::TypeClass_DOUBLE:
+    {
+        double d = 0;
+        value >>= d;
+        memcpy( &ret, &d, sizeof( d ) );
+        break;
+    }
+    case com::sun::star::uno::TypeClass_UNSIGNED_HYPER:
+    {
+        sal_uInt64 n = 0;
+        value >>= n;
+        ret = (sal_Int64) n;
+        break;
+    }
+    default:
+        value >>= ret;
+    }
+    return ret;
+}
+
+void IndexBuilder::build( const Reference< XTypeDescriptionEnumeration > & xEnum )
+{
+    while( xEnum->hasMoreElements() )
+    {
+        Reference< XTypeDescription > xType = xEnum->nextTypeDescription();
+        TypeClass typeClass = xType->getTypeClass();
+        if( typeClass == com::sun::star::uno::TypeClass_CONSTANT )
+            continue; // added together with its group
+
+        OUString name = xType->getName();
+        sal_uInt16 flags = 0;
+        if( typeClass == com::sun::star::uno::TypeClass_STRUCT && isPolymorphicStruct( xType ) )
+            flags |= TYPEINDEX_POLYMORPHIC_STRUCT;
+        add( name, typeClass, flags, com::sun::star::uno::TypeClass_VOID, 0 );
+
+        if( typeClass == com::sun::star::uno::TypeClass_CONSTANTS )
+        {
+            Reference< XConstantsTypeDescription > xConstants( xType, UNO_QUERY );
+            Sequence< Reference< XConstantTypeDescription > > constants;
+            if( xConstants.is() )
+                constants = xConstants->getConstants();
+            for( sal_Int32 i = 0 ; i < constants.getLength() ; i ++ )
+            {
+                TypeClass valueTypeClass;
+                sal_Int64 value = constantValue(
+                    constants[i]->getConstantValue(), valueTypeClass );
+                add( constants[i]->getName(), com::sun::star::uno::TypeClass_CONSTANT, 0,
+                     valueTypeClass, value );
+            }
+        }
+        else if( typeClass == com::sun::star::uno::TypeClass_ENUM )
+        {
+            Reference< XEnumTypeDescription > xEnumType( xType, UNO_QUERY );
+            if( xEnumType.is() )
+            {
+                Sequence< OUString > names = xEnumType->getEnumNames();
+                Sequence< sal_Int32 > values = xEnumType->getEnumValues();
+                for( sal_Int32 i = 0 ; i < names.getLength() && i < values.getLength() ; i ++ )
+                {
+                    OUStringBuffer buf( name.getLength() + 1 + names[i].getLength() );
+                    buf.append( name ).append( (sal_Unicode) '.' ).append( names[i] );
+                    add( buf.makeStringAndClear(), com::sun::star::uno::TypeClass_ENUM,
+                         TYPEINDEX_ENUM_VALUE, com::sun::star::uno::TypeClass_LONG, values[i] );
+                }
+            }
+        }
+    }
+
+    // link the elements to their modules in the order of the type manager
+    for( sal_uInt32 i = 0 ; i < maEntries.size() ; i ++ )
+    {
+        sal_Int32 nDot = maEntries[i].name.lastIndexOf( '.' );
+        if( nDot < 0 )
+            continue;
+        ::std::hash_map< OString, sal_uInt32, rtl::OStringHash >::const_iterator ii =
+            maNames.find( maEntries[i].name.copy( 0, nDot ) );
+        if( ii == maNames.end() )
+            continue;
+        BuildEntry & parent = maEntries[ ii->second ];
+        if( parent.lastChild == TYPEINDEX_NO_ENTRY )
+            parent.entry.firstChild = i;
+        else
+            maEntries[ parent.lastChild ].entry.nextSibling = i;
+        parent.lastChild = i;
+    }
+}
+
+void IndexBuilder::write(
+    ::std::vector< sal_Char > & data, const ::std::vector< OString > & sources,
+    const ::std::vector< IndexSource > & sourceStates )
+{
+    sal_uInt32 nEntries = maEntries.size();
+    sal_uInt32 nBuckets = 16;
+    while( nBuckets < nEntries )
+        nBuckets *= 2;
+
+    ::std::vector< sal_uInt32 > buckets( nBuckets, TYPEINDEX_NO_ENTRY );
+    OStringBuffer strings( nEntries * 32 );
+    sal_uInt32 i;
+    for( i = 0 ; i < nEntries ; i ++ )
+    {
+        TypeIndexEntry & entry = maEntries[i].entry;
+        entry.name = strings.getLength();
+        strings.append( maEntries[i].name ).append( '\0' );
+        sal_uInt32 & bucket = buckets[ entry.hash & ( nBuckets - 1 ) ];
+        entry.nextInBucket = bucket;
+        bucket = i;
+    }
+    ::std::vector< IndexSource > states( sourceStates );
+    for( i = 0 ; i < states.size() ; i ++ )
+    {
+        states[i].url = strings.getLength();
+        strings.append( sources[i] ).append( '\0' );
+    }
+    // keep the size of the whole file a multiple of 8
+    while( strings.getLength() % 8 )
+        strings.append( '\0' );
+
+    IndexHeader header;
+    memcpy( header.magic, INDEX_MAGIC, sizeof( INDEX_MAGIC ) );
+    header.nSources = states.size();
+    header.nBuckets = nBuckets;
+    header.nEntries = nEntries;
+    header.nStringSize = strings.getLength();
+
+    data.clear();
+    data.reserve( sizeof( header ) + states.size() * sizeof( IndexSource ) +
+                  nBuckets * sizeof( sal_uInt32 ) + nEntries * sizeof( TypeIndexEntry ) +
+                  header.nStringSize );
+    const sal_Char *p = reinterpret_cast< const sal_Char * >( &header );
+    data.insert( data.end(), p, p + sizeof( header ) );
+    for( i = 0 ; i < states.size() ; i ++ )
+    {
+        p = reinterpret_cast< const sal_Char * >( &states[i] );
+        data.insert( data.end(), p, p + sizeof( IndexSource ) );
+    }
+    p = reinterpret_cast< const sal_Char * >( &buckets[0] );
+    data.insert( data.end(), p, p + nBuckets * sizeof( sal_uInt32 ) );
+    for( i = 0 ; i < nEntries ; i ++ )
+    {
+        p = reinterpret_cast< const sal_Char * >( &maEntries[i].entry );
+        data.insert( data.end(), p, p + sizeof( TypeIndexEntry ) );
+    }
+    data.insert( data.end(), strings.getStr(), strings.getStr() + header.nStringSize );
+}
+
+/** splits UNO_TYPES into the urls of the type libraries */
+void readSources( const OUString & unoTypes, ::std::vector< OString > & sources )
+{
+    sal_Int32 nIndex = 0;
+    do
+    {
+        OUString token = unoTypes.getToken( 0, ' ', nIndex );
+        if( token.getLength() && token[0] == '?' )
+            token = token.copy( 1 );
+        if( token.getLength() )
+            sources.push_back( OUStringToOString( token, RTL_TEXTENCODING_UTF8 ) );
+    }
+    while( nIndex >= 0 );
+}
+
+IndexSource getSourceState( const OString & url )
+{
+    IndexSource state;
+    memset( &state, 0, sizeof( state ) );
+    osl::DirectoryItem item;
+    if( osl::DirectoryItem::get(
+            OStringToOUString( url, RTL_TEXTENCODING_UTF8 ), item ) == osl::FileBase::E_None )
+    {
+        osl::FileStatus status( osl_FileStatus_Mask_ModifyTime | osl_FileStatus_Mask_FileSize );
+        if( item.getFileStatus( status ) == osl::FileBase::E_None )
+        {
+            state.modifyTime = status.getModifyTime().Seconds;
+            state.size = status.getFileSize();
+        }
+    }
+    return state;
+}
+
+bool writeIndexFile( const OUString & url, const ::std::vector< sal_Char > & data )
+{
+    sal_Int32 nSlash = url.lastIndexOf( '/' );
+    if( nSlash > 0 )
+        osl::Directory::create( url.copy( 0, nSlash ) );
+
+    // other processes may build the index at the same time, so the file is
+    // written under a private name and renamed afterwards
+    oslProcessInfo info;
+    info.Size = sizeof( info );
+    osl_getProcessInfo( 0, osl_Process_IDENTIFIER, &info );
+    OUStringBuffer buf;
+    buf.append( url ).appendAscii( RTL_CONSTASCII_STRINGPARAM( ".tmp" ) );
+    buf.append( (sal_Int32) info.Ident );
+    OUString tmpUrl( buf.makeStringAndClear() );
+
+    osl::File file( tmpUrl );
+    if( file.open( osl_File_OpenFlag_Write | osl_File_OpenFlag_Create ) != osl::FileBase::E_None )
+        return false;
+    sal_uInt64 nWritten = 0;
+    bool bOk = file.write( &data[0], data.size(), nWritten ) == osl::FileBase::E_None &&
+        nWritten == data.size();
+    file.close();
+    if( bOk )
+        bOk = osl::File::move( tmpUrl, url ) == osl::FileBase::E_None;
+    if( ! bOk )
+        osl::File::remove( tmpUrl );
+    return bOk;
+}
+
+}
+
+bool isPolymorphicStruct( const Reference< XTypeDescription > & xType )
+{
+    if( ! xType.is() || xType->getTypeClass() != com::sun::star::uno::TypeClass_STRUCT )
+        return false;
+    Reference< XStructTypeDescription > xStruct( xType, UNO_QUERY );
+    if( ! xStruct.is() )
+        return false;
+    if( xStruct->getTypeParameters().getLength() )
+        return true;
+    return isPolymorphicStruct( xStruct->getBaseType() );
+}
+
+TypeIndex::TypeIndex( void *pData, sal_uInt64 nSize, bool bMapped )
+    : mpData( pData ),
+      mnSize( nSize ),
+      mbMapped( bMapped ),
+      mpBuckets( 0 ),
+      mpEntries( 0 ),
+      mpStrings( 0 ),
+      mnBuckets( 0 ),
+      mnEntries( 0 )
+{}
+
+TypeIndex::~TypeIndex()
+{
+    if( mbMapped )
+        osl_unmapFile( mpData, mnSize );
+    else
+        rtl_freeMemory( mpData );
+}
+
+bool TypeIndex::init( const ::std::vector< OString > & sources )
+{
+    const sal_Char *pData = static_cast< const sal_Char * >( mpData );
+    if( mnSize < sizeof( IndexHeader ) )
+        return false;
+    const IndexHeader *pHeader = reinterpret_cast< const IndexHeader * >( pData );
+    if( memcmp( pHeader->magic, INDEX_MAGIC, sizeof( INDEX_MAGIC ) ) != 0 ||
+        pHeader->nSources != sources.size() ||
+        ! pHeader->nBuckets || ( pHeader->nBuckets & ( pHeader->nBuckets - 1 ) ) ||
+        mnSize != sizeof( IndexHeader ) +
+                  (sal_uInt64) pHeader->nSources * sizeof( IndexSource ) +
+                  (sal_uInt64) pHeader->nBuckets * sizeof( sal_uInt32 ) +
+                  (sal_uInt64) pHeader->nEntries * sizeof( TypeIndexEntry ) +
+                  pHeader->nStringSize )
+    {
+        return false;
+    }
+
+    const IndexSource *pSources =
+        reinterpret_cast< const IndexSource * >( pData + sizeof( IndexHeader ) );
+    mpBuckets = reinterpret_cast< const sal_uInt32 * >( pSources + pHeader->nSources );
+    mpEntries = reinterpret_cast< const TypeIndexEntry * >( mpBuckets + pHeader->nBuckets );
+    mpStrings = reinterpret_cast< const sal_Char * >( mpEntries + pHeader->nEntries );
+    mnBuckets = pHeader->nBuckets;
+    mnEntries = pHeader->nEntries;
+    sal_uInt32 nStringSize = pHeader->nStringSize;
+
+    // outdated, when one of the type libraries has changed
+    sal_uInt32 i;
+    for( i = 0 ; i < pHeader->nSources ; i ++ )
+    {
+        IndexSource state = getSourceState( sources[i] );
+        if( pSources[i].url + sources[i].getLength() >= nStringSize ||
+            0 != strcmp( mpStrings + pSources[i].url, sources[i].getStr() ) ||
+            pSources[i].modifyTime != state.modifyTime ||
+            pSources[i].size != state.size )
+        {
+            return false;
+        }
+    }
+
+    // the file may have been damaged, so don't trust any offset
+    for( i = 0 ; i < mnBuckets ; i ++ )
+    {
+        if( mpBuckets[i] != TYPEINDEX_NO_ENTRY && mpBuckets[i] >= mnEntries )
+            return false;
+    }
+    for( i = 0 ; i < mnEntries ; i ++ )
+    {
+        const TypeIndexEntry & e = mpEntries[i];
+        if( (sal_uInt64) e.name + e.nameLength >= nStringSize ||
+            ( e.nextInBucket != TYPEINDEX_NO_ENTRY && e.nextInBucket >= mnEntries ) ||
+            ( e.firstChild != TYPEINDEX_NO_ENTRY && e.firstChild >= mnEntries ) ||
+            ( e.nextSibling != TYPEINDEX_NO_ENTRY && e.nextSibling >= mnEntries ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const TypeIndexEntry *TypeIndex::find( const sal_Char *name, sal_Int32 length ) const
+{
+    sal_uInt32 hash = hashName( name, length );
+    sal_uInt32 i = mpBuckets[ hash & ( mnBuckets - 1 ) ];
+    while( i != TYPEINDEX_NO_ENTRY )
+    {
+        const TypeIndexEntry *pEntry = mpEntries + i;
+        if( pEntry->hash == hash && pEntry->nameLength == (sal_uInt32) length &&
+            0 == memcmp( mpStrings + pEntry->name, name, length ) )
+        {
+            return pEntry;
+        }
+        i = pEntry->nextInBucket;
+    }
+    return 0;
+}
+
+OUString TypeIndex::getSimpleName( const TypeIndexEntry *pEntry ) const
+{
+    const sal_Char *name = getName( pEntry );
+    sal_Int32 nStart = pEntry->nameLength;
+    while( nStart > 0 && name[ nStart - 1 ] != '.' )
+        nStart --;
+    return OUString( name + nStart, pEntry->nameLength - nStart, RTL_TEXTENCODING_UTF8 );
+}
+
+Any TypeIndex::getConstantValue( const TypeIndexEntry *pEntry ) const
+{
+    union
+    {
+        sal_Bool b;
+        sal_Int8 n8;
+        sal_Int16 n16;
+        sal_Int32 n32;
+        sal_Int64 n64;
+        float f;
+        double d;
+    } value;
+
+    typelib_TypeClass typeClass = (typelib_TypeClass) pEntry->valueTypeClass;
+    switch( typeClass )
+    {
+    case typelib_TypeClass_BOOLEAN:
+        value.b = pEntry->value != 0;
+        break;
+    case typelib_TypeClass_BYTE:
+        value.n8 = (sal_Int8) pEntry->value;
+        break;
+    case typelib_TypeClass_SHORT:
+    case typelib_TypeClass_UNSIGNED_SHORT:
+        value.n16 = (sal_Int16) pEntry->value;
+        break;
+    case typelib_TypeClass_LONG:
+    case typelib_TypeClass_UNSIGNED_LONG:
+        value.n32 = (sal_Int32) pEntry->value;
+        break;
+    case typelib_TypeClass_HYPER:
+    case typelib_TypeClass_UNSIGNED_HYPER:
+        value.n64 = pEntry->value;
+        break;
+    case typelib_TypeClass_FLOAT:
+    case typelib_TypeClass_DOUBLE:
+        memcpy( &value.d, &pEntry->value, sizeof( value.d ) );
+        if( typeClass == typelib_TypeClass_FLOAT )
+            value.f = (float) value.d;
+        break;
+    default:
+        return Any();
+    }
+    return Any( &value, *typelib_static_type_getByTypeClass( typeClass ) );
+}
+
+TypeIndex *TypeIndex::create( const Runtime & runtime )
+{
+    RuntimeCargo *cargo = runtime.getImpl()->cargo;
+    rtl::Bootstrap bootstrapHandle( getPyUnoIniFileName() );
+
+    // without knowing the type libraries, the index can't be validated
+    OUString unoTypes;
+    ::std::vector< OString > sources;
+    if( bootstrapHandle.getFrom( USTR_ASCII( "UNO_TYPES" ), unoTypes ) )
+        readSources( unoTypes, sources );
+    if( sources.empty() )
+        return 0;
+
+    OUString url;
+    if( ! bootstrapHandle.getFrom( USTR_ASCII( "PYUNO_TYPEINDEX" ), url ) )
+    {
+        // different installations get different files
+        OUString home;
+        if( ! osl::Security().getHomeDir( home ) )
+            return 0;
+        OString key( OUStringToOString( unoTypes, RTL_TEXTENCODING_UTF8 ) );
+        OUStringBuffer buf;
+        buf.append( home ).appendAscii( RTL_CONSTASCII_STRINGPARAM( "/.pyuno/typeindex-" ) );
+        buf.append( (sal_Int64) hashName( key.getStr(), key.getLength() ), 16 );
+        url = buf.makeStringAndClear();
+    }
+    if( ! url.getLength() )
+        return 0; // switched off
+
+    // map an existing index
+    oslFileHandle hFile = 0;
+    if( osl_openFile( url.pData, &hFile, osl_File_OpenFlag_Read ) == osl_File_E_None )
+    {
+        sal_uInt64 nSize = 0;
+        void *pData = 0;
+        bool bMapped =
+            osl_getFileSize( hFile, &nSize ) == osl_File_E_None && nSize &&
+            osl_mapFile( hFile, &pData, nSize, 0, osl_File_MapFlag_RandomAccess ) == osl_File_E_None;
+        osl_closeFile( hFile );
+        if( bMapped )
+        {
+            TypeIndex *pIndex = new TypeIndex( pData, nSize, true );
+            if( pIndex->init( sources ) )
+                return pIndex;
+            delete pIndex;
+        }
+    }
+
+    // build it from the type manager
+    Reference< XTypeDescriptionEnumerationAccess > xAccess( cargo->xTdMgr, UNO_QUERY );
+    if( ! xAccess.is() )
+        return 0;
+    log( cargo, LogLevel::CALL, "building the type index" );
+
+    ::std::vector< IndexSource > states;
+    for( sal_uInt32 i = 0 ; i < sources.size() ; i ++ )
+        states.push_back( getSourceState( sources[i] ) );
+    IndexBuilder builder;
+    builder.build( xAccess->createTypeDescriptionEnumeration(
+                       OUString(), Sequence< TypeClass >(),
+                       com::sun::star::reflection::TypeDescriptionSearchDepth_INFINITE ) );
+    ::std::vector< sal_Char > data;
+    builder.write( data, sources, states );
+
+    if( ! writeIndexFile( url, data ) )
+        log( cargo, LogLevel::CALL, "couldn't write the type index" );
+
+    void *pData = rtl_allocateMemory( data.size() );
+    memcpy( pData, &data[0], data.size() );
+    TypeIndex *pIndex = new TypeIndex( pData, data.size(), false );
+    if( pIndex->init( sources ) )
+        return pIndex;
+    delete pIndex;
+    return 0;
+}
+
+TypeIndex *getTypeIndex( const Runtime & runtime )
+{
+    RuntimeCargo *cargo = runtime.getImpl()->cargo;
+    if( ! cargo->typeIndexChecked )
+    {
+        // other threads use the type manager meanwhile
+        cargo->typeIndexChecked = true;
+        TypeIndex *pIndex = 0;
+        try
+        {
+            PyThreadDetach antiguard;
+            pIndex = TypeIndex::create( runtime );
+        }
+        catch( com::sun::star::uno::Exception & e )
+        {
+            log( cargo, LogLevel::CALL, e.Message );
+        }
+        cargo->typeIndex = pIndex;
+    }
+    return cargo->typeIndex;
+}
+
+}
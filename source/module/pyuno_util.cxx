@@ -28,7 +28,9 @@
 
 #include <typelib/typedescription.hxx>
 
+#include <rtl/alloc.h>
 #include <rtl/strbuf.hxx>
+#include <rtl/textcvt.h>
 #include <rtl/ustrbuf.hxx>
 #include <osl/time.h>
 
@@ -77,6 +79,19 @@ PyRef ustring2PyUnicode( const OUString & str )
     return ret;
 }
 
+PyRef ustring2PyInternedString( const OUString & str )
+{
+    OString sUtf8( OUStringToOString( str, RTL_TEXTENCODING_UTF8 ) );
+#if PY_VERSION_HEX >= 0x03000000
+    PyObject *p = PyUnicode_DecodeUTF8( sUtf8.getStr(), sUtf8.getLength(), NULL );
+    if( p )
+        PyUnicode_InternInPlace( &p );
+    return PyRef( p, SAL_NO_ACQUIRE );
+#else
+    return PyRef( PyString_InternFromString( sUtf8.getStr() ), SAL_NO_ACQUIRE );
+#endif
+}
+
 #if PY_VERSION_HEX < 0x03000000
 PyRef ustring2PyString( const OUString &str )
 {
@@ -129,6 +144,152 @@ PyRef getObjectFromUnoModule( const Runtime &runtime, const char * func )
 }
 
 
+//------------------------------------------------------------------------------------
+// Scratch area
+//------------------------------------------------------------------------------------
+
+static const sal_Int32 SCRATCH_STRINGS = 4;
+static const sal_Int32 SCRATCH_STRING_LENGTH = 64;
+static const sal_Int32 SCRATCH_MAX_CAPACITY = 65536;
+
+/** Temporaries of the calls of one thread, reused by its next calls instead
+    of being allocated again.
+*/
+struct ScratchArea
+{
+    rtl_uString *strings[SCRATCH_STRINGS]; // of capacity SCRATCH_STRING_LENGTH
+    OUStringBuffer logLine;
+    bool bLogLineUsed;
+    sal_Char *pLogBytes;
+    sal_Int32 nLogBytes;
+    rtl_TextEncoding logEncoding;
+    rtl_UnicodeToTextConverter logConverter;
+};
+
+extern "C" {
+
+static void SAL_CALL releaseScratchArea( void *pData )
+{
+    ScratchArea *pArea = static_cast< ScratchArea * >( pData );
+    for( sal_Int32 i = 0 ; i < SCRATCH_STRINGS ; i ++ )
+    {
+        if( pArea->strings[i] )
+            rtl_uString_release( pArea->strings[i] );
+    }
+    if( pArea->pLogBytes )
+        rtl_freeMemory( pArea->pLogBytes );
+    if( pArea->logConverter )
+        rtl_destroyUnicodeToTextConverter( pArea->logConverter );
+    delete pArea;
+}
+
+}
+
+/** @return the scratch area of the calling thread, 0 if it cannot be set up */
+static ScratchArea *getScratchArea()
+{
+    static oslThreadKey key = osl_createThreadKey( releaseScratchArea );
+    if( ! key )
+        return 0;
+    ScratchArea *pArea = static_cast< ScratchArea * >( osl_getThreadKeyData( key ) );
+    if( ! pArea )
+    {
+        pArea = new ScratchArea;
+        for( sal_Int32 i = 0 ; i < SCRATCH_STRINGS ; i ++ )
+            pArea->strings[i] = 0;
+        pArea->bLogLineUsed = false;
+        pArea->pLogBytes = 0;
+        pArea->nLogBytes = 0;
+        pArea->logEncoding = RTL_TEXTENCODING_DONTKNOW;
+        pArea->logConverter = 0;
+        if( ! osl_setThreadKeyData( key, pArea ) )
+        {
+            releaseScratchArea( pArea );
+            return 0;
+        }
+    }
+    return pArea;
+}
+
+OUString getScratchString( const char *ascii )
+{
+    sal_Int32 nLength = rtl_str_getLength( ascii );
+    ScratchArea *pArea = nLength <= SCRATCH_STRING_LENGTH ? getScratchArea() : 0;
+    if( ! pArea )
+        return OUString::createFromAscii( ascii );
+
+    // a string is free when the area holds the only reference. Others are
+    // released with interlocked decrements, so they are done with the
+    // contents once the count is back to 1.
+    rtl_uString **ppStr = 0;
+    for( sal_Int32 i = 0 ; i < SCRATCH_STRINGS && ! ppStr ; i ++ )
+    {
+        if( ! pArea->strings[i] || pArea->strings[i]->refCount == 1 )
+            ppStr = &pArea->strings[i];
+    }
+    if( ! ppStr )
+    {
+        // all kept beyond their calls, their holders keep them alive
+        ppStr = &pArea->strings[0];
+        rtl_uString_release( *ppStr );
+        *ppStr = 0;
+    }
+    if( ! *ppStr )
+        rtl_uString_new_WithLength( ppStr, SCRATCH_STRING_LENGTH );
+
+    rtl_uString *pStr = *ppStr;
+    for( sal_Int32 i = 0 ; i < nLength ; i ++ )
+        pStr->buffer[i] = (sal_Unicode) (unsigned char) ascii[i];
+    pStr->buffer[nLength] = 0;
+    pStr->length = nLength;
+    return OUString( pStr );
+}
+
+namespace {
+
+/** The log buffer of the thread for one log line, a nested log call
+    builds its line in a buffer of its own.
+*/
+class LogLine
+{
+public:
+    LogLine() : mpArea( getScratchArea() ), mpOwn( 0 )
+    {
+        if( mpArea && ! mpArea->bLogLineUsed )
+            mpArea->bLogLineUsed = true;
+        else
+            mpOwn = new OUStringBuffer( 128 );
+    }
+
+    ~LogLine()
+    {
+        if( mpOwn )
+        {
+            delete mpOwn;
+            return;
+        }
+        if( mpArea->logLine.getCapacity() > SCRATCH_MAX_CAPACITY )
+            mpArea->logLine = OUStringBuffer( 128 );
+        else
+            mpArea->logLine.setLength( 0 );
+        mpArea->bLogLineUsed = false;
+    }
+
+    OUStringBuffer & get()
+    {
+        return mpOwn ? *mpOwn : mpArea->logLine;
+    }
+
+private:
+    LogLine( const LogLine & );
+    LogLine & operator =( const LogLine & );
+
+    ScratchArea *mpArea;
+    OUStringBuffer *mpOwn;
+};
+
+}
+
 //------------------------------------------------------------------------------------
 // Logging
 //------------------------------------------------------------------------------------
@@ -138,9 +299,60 @@ bool isLog( RuntimeCargo * cargo, sal_Int32 loglevel )
     return cargo && cargo->logFile && loglevel <= cargo->logLevel;
 }
 
+/** writes a log line, converted in the byte buffer of the scratch area */
+static void log( RuntimeCargo * cargo, sal_Int32 level, const sal_Unicode *pStr, sal_Int32 nLength )
+{
+    if( ! isLog( cargo, level ) )
+        return;
+    rtl_TextEncoding encoding = osl_getThreadTextEncoding();
+    ScratchArea *pArea = getScratchArea();
+    if( pArea && pArea->logEncoding != encoding )
+    {
+        if( pArea->logConverter )
+            rtl_destroyUnicodeToTextConverter( pArea->logConverter );
+        pArea->logConverter = rtl_createUnicodeToTextConverter( encoding );
+        pArea->logEncoding = encoding;
+    }
+    if( ! pArea || ! pArea->logConverter )
+    {
+        log( cargo, level, OUStringToOString( OUString( pStr, nLength ), encoding ).getStr() );
+        return;
+    }
+
+    sal_Int32 nNeeded = 2 * nLength + 1;
+    for( ;; )
+    {
+        if( pArea->nLogBytes < nNeeded )
+        {
+            if( pArea->pLogBytes )
+                rtl_freeMemory( pArea->pLogBytes );
+            pArea->pLogBytes = (sal_Char *) rtl_allocateMemory( nNeeded );
+            pArea->nLogBytes = nNeeded;
+        }
+        sal_uInt32 nInfo = 0;
+        sal_Size nConverted = 0;
+        sal_Size nBytes = rtl_convertUnicodeToText(
+            pArea->logConverter, 0, pStr, nLength, pArea->pLogBytes, pArea->nLogBytes - 1,
+            OUSTRING_TO_OSTRING_CVTFLAGS, &nInfo, &nConverted );
+        if( ! ( nInfo & RTL_UNICODETOTEXT_INFO_DESTBUFFERTOSMALL ) )
+        {
+            pArea->pLogBytes[ nBytes ] = 0;
+            break;
+        }
+        nNeeded = 2 * pArea->nLogBytes;
+    }
+    log( cargo, level, pArea->pLogBytes );
+    if( pArea->nLogBytes > SCRATCH_MAX_CAPACITY )
+    {
+        rtl_freeMemory( pArea->pLogBytes );
+        pArea->pLogBytes = 0;
+        pArea->nLogBytes = 0;
+    }
+}
+
 void log( RuntimeCargo * cargo, sal_Int32 level, const rtl::OUString &logString )
 {
-    log( cargo, level, OUStringToOString( logString, osl_getThreadTextEncoding() ).getStr() );
+    log( cargo, level, logString.getStr(), logString.getLength() );
 }
 
 void log( RuntimeCargo * cargo, sal_Int32 level, const char *str )
@@ -191,7 +403,8 @@ void logException( RuntimeCargo *cargo, const char *intro,
 {
     if( isLog( cargo, LogLevel::CALL ) )
     {
-        rtl::OUStringBuffer buf( 128 );
+        LogLine line;
+        rtl::OUStringBuffer & buf = line.get();
         buf.appendAscii( intro );
         appendPointer(buf, ptr);
         buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("].") );
@@ -199,7 +412,7 @@ void logException( RuntimeCargo *cargo, const char *intro,
         buf.appendAscii( RTL_CONSTASCII_STRINGPARAM( " = " ) );
         buf.append(
             val2str( data, type.getTypeLibType(), VAL2STR_MODE_SHALLOW ) );
-        log( cargo,LogLevel::CALL, buf.makeStringAndClear() );
+        log( cargo,LogLevel::CALL, buf.getStr(), buf.getLength() );
     }
 
 }
@@ -212,7 +425,8 @@ void logReply(
     const Any &returnValue, 
     const Sequence< Any > & aParams )
 {
-    rtl::OUStringBuffer buf( 128 );
+    LogLine line;
+    rtl::OUStringBuffer & buf = line.get();
     buf.appendAscii( intro );
     appendPointer(buf, ptr);
     buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("].") );
@@ -229,7 +443,7 @@ void logReply(
                 val2str( aParams[i].getValue(), aParams[i].getValueTypeRef(), VAL2STR_MODE_SHALLOW) );
         }
     }
-    log( cargo,LogLevel::CALL, buf.makeStringAndClear() );
+    log( cargo,LogLevel::CALL, buf.getStr(), buf.getLength() );
     
 }
 
@@ -237,7 +451,8 @@ void logCall( RuntimeCargo *cargo, const char *intro,
               void * ptr, const rtl::OUString & aFunctionName,
               const Sequence< Any > & aParams )
 {
-    rtl::OUStringBuffer buf( 128 );
+    LogLine line;
+    rtl::OUStringBuffer & buf = line.get();
     buf.appendAscii( intro );
     appendPointer(buf, ptr);
     buf.appendAscii( RTL_CONSTASCII_STRINGPARAM("].") );
@@ -254,7 +469,7 @@ void logCall( RuntimeCargo *cargo, const char *intro,
         }
     }
     buf.appendAscii( RTL_CONSTASCII_STRINGPARAM(")") );
-    log( cargo,LogLevel::CALL, buf.makeStringAndClear() );
+    log( cargo,LogLevel::CALL, buf.getStr(), buf.getLength() );
 }
 
 
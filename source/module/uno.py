@@ -23,6 +23,7 @@ import sys
 import pyuno
 import socket # since on Windows sal3.dll no longer calls WSAStartup
 import importlib.abc
+import collections.abc
 import types
 import traceback
 
@@ -30,6 +31,11 @@ import traceback
 # and can be changed at any time. Don't use them
 _g_ctx = pyuno.getComponentContext( )
 
+# besides lists, tuples, ranges and generators pyuno converts instances of
+# this class to sequences, and besides dicts those of _MappingABC to named values
+_SequenceABC = collections.abc.Sequence
+_MappingABC = collections.abc.Mapping
+
 
 def getComponentContext():
     """ returns the UNO component context, that was used to initialize the python runtime.
@@ -46,7 +52,7 @@ def getTypeByName( typeName):
     """
     return pyuno.getTypeByName( typeName )
 
-def createUnoStruct( typeName, *args ):
+def createUnoStruct( typeName, *args, **kwargs ):
     """creates a uno struct or exception given by typeName. The parameter args may
     1) be empty. In this case, you get a default constructed uno structure.
        ( e.g. createUnoStruct( "com.sun.star.uno.Exception" ) )
@@ -58,8 +64,11 @@ def createUnoStruct( typeName, *args ):
        createUnoStruct( "com.sun.star.uno.Exception", "foo error" , self) ). The
        elements with in the sequence must match the type of each struct element,
        otherwise an exception is thrown.
+    Members may also be given as keyword arguments, members neither given
+    positionally nor by keyword keep their default value
+    ( e.g. createUnoStruct( "com.sun.star.beans.PropertyValue", Name="Hidden", Value=True ) ).
     """
-    return getClass(typeName)( *args )
+    return getClass(typeName)( *args, **kwargs )
 
 def getClass( typeName ):
     """returns the class of a concrete uno exception, struct or interface
@@ -102,6 +111,91 @@ def setCurrentContext( newContext ):
     """
     return pyuno.setCurrentContext( newContext )
 
+def setLazySequences( enabled ):
+    """Sequences returned from UNO are converted to tuples by default. When
+    enabled, they are returned as immutable uno.UNOSequence views instead,
+    which convert their elements on access and are passed back to UNO
+    without conversion. Returns the previous setting.
+    """
+    return pyuno.setLazySequences( enabled )
+
+def propertiesToDict( values ):
+    """Returns a dict mapping the names to the values of a sequence of
+    com.sun.star.beans.PropertyValue or NamedValue structs. A dict passed
+    to a method is converted to NamedValues, where the parameter is a
+    sequence of NamedValue, and to PropertyValues otherwise. Other values,
+    like any typed parameters, get NamedValues through
+    uno.invoke( obj, name, ( uno.Any( "[]com.sun.star.beans.NamedValue", d ), ) ).
+    """
+    return pyuno.propertiesToDict( values )
+
+def setClassCacheLimit( limit ):
+    """Bounds the number of generated struct, exception and interface classes
+    kept by the runtime, least recently used ones are dropped first. 0 means
+    no limit, which is the default. A dropped class is reused as long as
+    python code refers to it and is rebuilt otherwise. Returns the previous
+    limit.
+    """
+    return pyuno.setClassCacheLimit( limit )
+
+def getClassCacheInfo():
+    """Returns a dict with the number of cached 'classes', the number of
+    'dropped' classes which are still alive, the 'limit' and the approximate
+    'memory' in bytes held by the cached classes.
+    """
+    return pyuno.getClassCacheInfo()
+
+def preloadClasses( typeNames ):
+    """Creates the classes for the given struct, exception and interface
+    names in advance."""
+    pyuno.preloadClasses( typeNames )
+
+def findUnoCycles():
+    """Returns the python objects exported to UNO, which are referenced by
+    nothing in python but their adapters and which hold UNO objects, as a
+    list of ( object, [ uno objects ] ).
+
+    Such an object, e.g. a listener keeping the broadcaster it is registered
+    at, may be part of a cycle through UNO, which neither the cycle collector
+    nor UNO reference counting can free. Break it by removing the listener
+    or dropping the reference to the UNO object.
+    """
+    import gc
+    exported = pyuno.getExportedObjects()
+    # the entries and this frame refer to the objects as well
+    ignored = set( id( entry ) for entry in exported )
+    ignored.add( id( sys._getframe() ) )
+    result = []
+    for obj, references in exported:
+        if references <= 0:
+            continue
+        referrers = [ r for r in gc.get_referrers( obj ) if id( r ) not in ignored ]
+        if referrers:
+            continue
+        wrappers = _findReachableWrappers( obj )
+        if wrappers:
+            result.append( ( obj, wrappers ) )
+    return result
+
+def _findReachableWrappers( obj ):
+    # follows containers and instance dicts only, classes and functions
+    # would lead to the module globals
+    import gc
+    found = []
+    seen = set( ( id( obj ), ) )
+    pending = [ obj ]
+    while pending:
+        for child in gc.get_referents( pending.pop() ):
+            if id( child ) in seen:
+                continue
+            seen.add( id( child ) )
+            if isinstance( child, pyuno.PyUNO ):
+                found.append( child )
+            elif not isinstance( child, ( type, types.ModuleType, types.FunctionType,
+                                          types.MethodType, types.BuiltinFunctionType ) ):
+                pending.append( child )
+    return found
+
 
 def hasModule(name):
     """ Check UNO module is there by its name. 
@@ -121,62 +215,17 @@ def getModuleElementNames(name):
     return pyuno.getModuleElementNames(name)
 
 
-class Enum:
-    "Represents a UNO idl enum, use an instance of this class to explicitly pass a boolean to UNO"
-    #typeName the name of the enum as a string
-    #value    the actual value of this enum as a string
-    def __init__(self,typeName, value):
-        self.typeName = typeName
-        self.value = value
-        pyuno.checkEnum( self )
-
-    def __repr__(self):
-        return "<uno.Enum %s (%r)>" % (self.typeName, self.value)
+# Enum, Type, Char and Any are implemented natively by pyuno. They hold
+# resolved type descriptions and their attributes are read-only.
 
-    def __eq__(self, that):
-        if not isinstance(that, Enum):
-            return False
-        return (self.typeName == that.typeName) and (self.value == that.value)
-
-class Type:
-    "Represents a UNO type, use an instance of this class to explicitly pass a boolean to UNO"
-#    typeName                 # Name of the UNO type
-#    typeClass                # python Enum of TypeClass,  see com/sun/star/uno/TypeClass.idl
-    def __init__(self, typeName, typeClass):
-        self.typeName = typeName
-        self.typeClass = typeClass
-        pyuno.checkType(self)
-    def __repr__(self):
-        return "<Type instance %s (%r)>" % (self.typeName, self.typeClass)
-
-    def __eq__(self, that):
-        if not isinstance(that, Type):
-            return False
-        return self.typeClass == that.typeClass and self.typeName == that.typeName
+Enum = pyuno.Enum
+"Represents a UNO idl enum, use an instance of this class to explicitly pass an enum to UNO"
 
-    def __hash__(self):
-        return self.typeName.__hash__()
-
-
-class Char:
-    "Represents a UNO char, use an instance of this class to explicitly pass a char to UNO"
-    # @param value pass a Unicode string with length 1
-    def __init__(self,value):
-        assert isinstance(value, str)
-        assert len(value) == 1
-        self.value=value
-
-    def __repr__(self):
-        return "<Char instance %s>" % (self.value, )
+Type = pyuno.Type
+"Represents a UNO type, use an instance of this class to explicitly pass a type to UNO"
 
-    def __eq__(self, that):
-        if isinstance(that, str):
-            if len(that) > 1:
-                return False
-            return self.value == that[0]
-        if isinstance(that, Char):
-            return self.value == that.value
-        return False
+Char = pyuno.Char
+"Represents a UNO char, use an instance of this class to explicitly pass a char to UNO"
 
 
 class ByteSequence:
@@ -218,14 +267,8 @@ class ByteSequence:
         return self.value.hash()
 
 
-class Any:
-    "use only in connection with uno.invoke() to pass an explicit typed any"
-    def __init__(self, type, value ):
-        if isinstance( type, Type ):
-            self.type = type
-        else:
-            self.type = getTypeByName( type )
-        self.value = value
+Any = pyuno.Any
+"use only in connection with uno.invoke() to pass an explicit typed any"
 
 def invoke( object, methodname, argTuple ):
     "use this function to pass exactly typed anys to the callee (using uno.Any)"
@@ -251,45 +294,10 @@ def _uno_extract_printable_stacktrace(trace):
     return ret
 
 
-class UNOBaseStruct:
-    """ Base class of UNO structs and exceptions. """
-    
-    def __init__(self, *args, **kwds):
-        if len(args) == 1 and isinstance(args[0], self.__class__):
-            value = args[0]
-        else:
-            value = pyuno._createUnoStructHelper(
-                        self.__class__.__pyunostruct__, args)
-        self.__dict__["value"] = value
-    
-    def __getattr__(self, name):
-        return getattr(self.__dict__["value"], name)
-    
-    def __setattr__(self, name, value):
-        return setattr(self.__dict__["value"], name, value)
-    
-    def __repr__(self):
-        return repr(self.__dict__["value"])
-    
-    def __str__(self):
-        return str(self.__dict__["value"])
-    
-    def __dir__(self):
-        return dir(self.__dict__["value"]) + list(self.__dict__.keys()) + \
-                list(self.__class__.__dict__.keys())
-    
-    def __eq__(self, other):
-        if hasattr(other, "value"):
-            return self.__dict__["value"] == other.__dict__["value"]
-        return False
-
-
-class UNOException(Exception, UNOBaseStruct):
-    """ Parent class of UNO exceptions. """
-
-
-class UNOStruct(UNOBaseStruct):
-    """ Parent class of UNO structs. """
+# Parent classes of UNO structs and exceptions, instances embed the UNO value
+UNOStruct = pyuno.UNOStruct
+UNOException = pyuno.UNOException
+UNOSequence = pyuno.UNOSequence
 
 
 class UNOModule(types.ModuleType):
@@ -308,34 +316,21 @@ class UNOModule(types.ModuleType):
         self.__initializing__ = False
     
     def __getattr__(self, elt):
-        value = None
-        
-        RuntimeException = pyuno.getClass("com.sun.star.uno.RuntimeException")
-        try:
-            value = pyuno.getClass(self.__path__ + "." + elt)
-        except RuntimeException:
+        if elt == "__all__":
+            RuntimeException = pyuno.getClass("com.sun.star.uno.RuntimeException")
             try:
-                value = Enum(self.__path__, elt)
+                module_names = pyuno.getModuleElementNames(self.__path__)
             except RuntimeException:
-                try:
-                    value = pyuno.getConstantByName(self.__path__ + "." + elt)
-                except RuntimeException:
-                    if elt.startswith("typeOf"):
-                        try:
-                            value = pyuno.getTypeByName(self.__path__ + "." + elt[6:])
-                        except RuntimeException:
-                            raise AttributeError(
-                                "type {}.{} is unknown".format(self.__path__, elt))
-                    elif elt == "__all__":
-                        try:
-                            module_names = pyuno.getModuleElementNames(self.__path__)
-                            self.__all__ = module_names
-                            return module_names
-                        except RuntimeException:
-                            raise AttributeError("__all__")
-                    else:
-                        raise AttributeError(
-                            "type {}.{} is unknown".format(self.__path__, elt))
+                raise AttributeError("__all__")
+            self.__all__ = module_names
+            return module_names
+        if elt.startswith("__"):
+            raise AttributeError(elt)
+        resolved = pyuno.resolve(self.__path__, elt)
+        if resolved is None:
+            raise AttributeError(
+                "type {}.{} is unknown".format(self.__path__, elt))
+        value = resolved[1]
         setattr(self, elt, value)
         return value
 
@@ -352,6 +347,11 @@ class UNOModuleLoader(importlib.abc.Loader):
             return sys.modules[fullname]
         else:
             mod = UNOModule(fullname, self)
+            # constants groups and enums are filled in one pass
+            values = pyuno.getModuleValues(fullname)
+            if values is not None:
+                mod.__dict__.update(values)
+                mod.__all__ = tuple(values)
         sys.modules.setdefault(fullname, mod)
         return mod
 
@@ -77,6 +77,59 @@ class PyUNOTestFunctions(unittest.TestCase):
         smgr = self.get_ctx().getServiceManager()
         self.assertIsNotNone(smgr)
     
+    def test_wrapper_identity(self):
+        doc = self.get_doc()
+        self.assertTrue(doc.getText() is doc.getText())
+    
+    def test_class_cache(self):
+        uno.preloadClasses(["com.sun.star.awt.Size", "com.sun.star.awt.XWindow"])
+        info = uno.getClassCacheInfo()
+        self.assertTrue(info["classes"] >= 2)
+        self.assertTrue(info["memory"] > 0)
+        size_class = uno.getClass("com.sun.star.awt.Size")
+        old_limit = uno.setClassCacheLimit(1)
+        try:
+            uno.getClass("com.sun.star.awt.Point")
+            self.assertEqual(uno.getClassCacheInfo()["classes"], 1)
+            # still referenced here, so it is reused instead of rebuilt
+            self.assertTrue(uno.getClass("com.sun.star.awt.Size") is size_class)
+            # a member descriptor keeps the tables of a dropped class alive
+            import gc
+            point = uno.getClass("com.sun.star.awt.Point")(1, 2)
+            x = type(point).__dict__["X"]
+            uno.getClass("com.sun.star.awt.Size")
+            gc.collect()
+            self.assertEqual(x.__get__(point), 1)
+            del point, x
+            gc.collect()
+            self.assertEqual(uno.getClass("com.sun.star.awt.Point")(3, 4).X, 3)
+        finally:
+            uno.setClassCacheLimit(old_limit)
+    
+    def test_findUnoCycles(self):
+        import unohelper
+        from com.sun.star.lang import XEventListener
+        class Listener(unohelper.Base, XEventListener):
+            def __init__(self, doc):
+                self.doc = doc
+            def disposing(self, ev):
+                pass
+        doc = self.get_doc()
+        doc.addEventListener(Listener(doc))
+        cycles = [c for c in uno.findUnoCycles() if isinstance(c[0], Listener)]
+        self.assertEqual(len(cycles), 1)
+        self.assertTrue(doc in cycles[0][1])
+        doc.removeEventListener(cycles[0][0])
+    
+    def test_wrapper_weakref_and_hash(self):
+        import weakref
+        text = self.get_doc().getText()
+        ref = weakref.ref(text)
+        self.assertTrue(ref() is text)
+        cursor = text.createTextCursor()
+        self.assertEqual(hash(cursor.getText()), hash(text))
+        self.assertEqual(len({text, cursor.getText()}), 1)
+    
     # functions defined in uno module
     
     def test_getComponentContext(self):
@@ -110,6 +163,10 @@ class PyUNOTestFunctions(unittest.TestCase):
         rect2 = uno.createUnoStruct("com.sun.star.awt.Rectangle", 100, 200, 50, 1)
         self.assertEqual(rect2.X, 100)
         rect3 = uno.createUnoStruct("com.sun.star.awt.Rectangle", rect2)
+        rect4 = uno.createUnoStruct("com.sun.star.awt.Rectangle", 100, Width=50)
+        self.assertEqual((rect4.X, rect4.Y, rect4.Width), (100, 0, 50))
+        self.assertRaises(TypeError, uno.createUnoStruct, "com.sun.star.awt.Rectangle", Foo=1)
+        self.assertRaises(TypeError, uno.createUnoStruct, "com.sun.star.awt.Rectangle", 1, X=1)
         #self.assertEqual(rect2, rect3)
     
     def test_getClass(self):
@@ -161,7 +218,21 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertTrue(pyuno.hasModule("com.sun.star.awt.FontWeight"))
         self.assertTrue(pyuno.hasModule("com.sun.star.awt.FontSlant"))
         self.assertFalse(pyuno.hasModule("foo"))
-    
+
+    def test_resolve(self):
+        import pyuno
+        kind, value = pyuno.resolve("com.sun.star.awt", "Rectangle")
+        self.assertEqual(kind, "class")
+        kind, value = pyuno.resolve("com.sun.star.awt.FontSlant", "ITALIC")
+        self.assertEqual(kind, "enum")
+        self.assertEqual(value, uno.Enum("com.sun.star.awt.FontSlant", "ITALIC"))
+        kind, value = pyuno.resolve("com.sun.star.awt.FontWeight", "BOLD")
+        self.assertEqual((kind, value), ("constant", 150.0))
+        kind, value = pyuno.resolve("com.sun.star.container", "typeOfXNameAccess")
+        self.assertEqual(kind, "type")
+        self.assertEqual(value.typeName, "com.sun.star.container.XNameAccess")
+        self.assertTrue(pyuno.resolve("com.sun.star.awt", "Foo") is None)
+
     def test_getModuleElementNames(self):
         self.assertTrue("sun" in uno.getModuleElementNames("com"))
         self.assertTrue("beans" in uno.getModuleElementNames("com.sun.star"))
@@ -181,6 +252,62 @@ class PyUNOTestFunctions(unittest.TestCase):
         _all = set(uno.getModuleElementNames("com.sun.star.awt.FontWeight"))
         self.assertTrue("BOLD" in _all)
     
+    def test_type_index_missing_module(self):
+        import pyuno
+        self.assertFalse(pyuno.hasModule("com.sun.star.nosuchmodule"))
+        self.assertEqual(len(uno.getModuleElementNames("com.sun.star.nosuchmodule")), 0)
+        self.assertTrue(pyuno.resolve("com.sun.star.nosuchmodule", "Foo") is None)
+        def do_import():
+            import com.sun.star.nosuchmodule
+        self.assertRaises(ImportError, do_import)
+    
+    def _run_with_type_index(self, index_path):
+        """ Runs lookups in a new process, which uses the index file. """
+        import subprocess
+        script = "\n".join((
+            "import uno, pyuno",
+            "assert pyuno.hasModule('com.sun.star.beans')",
+            "assert 'PropertyValue' in uno.getModuleElementNames('com.sun.star.beans')",
+            "assert 'DIRECT_VALUE' in uno.getModuleElementNames('com.sun.star.beans.PropertyState')",
+            "assert pyuno.resolve('com.sun.star.awt.FontWeight', 'BOLD') == ('constant', 150.0)",
+        ))
+        env = dict(os.environ)
+        env["PYUNO_TYPEINDEX"] = uno.systemPathToFileUrl(index_path)
+        env["PYTHONPATH"] = os.pathsep.join(sys.path)
+        self.assertEqual(subprocess.call([sys.executable, "-c", script], env=env), 0)
+    
+    def _read_type_index(self, index_path):
+        if not os.path.exists(index_path):
+            self.skipTest("no UNO_TYPES, the type index is not used")
+        with open(index_path, "rb") as f:
+            return f.read()
+    
+    def test_type_index_corrupt_file(self):
+        import tempfile
+        index_path = os.path.join(tempfile.mkdtemp(), "typeindex")
+        with open(index_path, "wb") as f:
+            f.write(b"PYUNOTI1" + b"\xff" * 64)
+        self._run_with_type_index(index_path)
+        data = self._read_type_index(index_path)
+        # rebuilt over the damaged file
+        self.assertTrue(data.startswith(b"PYUNOTI1"))
+        self.assertTrue(len(data) > 72)
+    
+    def test_type_index_stale(self):
+        import tempfile, struct
+        index_path = os.path.join(tempfile.mkdtemp(), "typeindex")
+        self._run_with_type_index(index_path)
+        data = bytearray(self._read_type_index(index_path))
+        # modifyTime of the first source, behind the header and url offsets
+        offset = 8 + 4 * 4 + 4 + 4
+        modify_time = struct.unpack_from("=Q", data, offset)[0]
+        struct.pack_into("=Q", data, offset, modify_time + 1)
+        with open(index_path, "wb") as f:
+            f.write(data)
+        self._run_with_type_index(index_path)
+        data = self._read_type_index(index_path)
+        self.assertEqual(struct.unpack_from("=Q", data, offset)[0], modify_time)
+    
     # classes defined in uno module
     
     def test_Enum(self):
@@ -193,6 +320,8 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertEqual(repr(e), repr_desired)
         e2 = uno.Enum(type_name, value)
         self.assertTrue(e == e2)
+        self.assertEqual(hash(e), hash(e2))
+        self.assertEqual({e: 1}[e2], 1)
         
         type_name2 = "com.sun.star.beans.PropertyState"
         value2 = "DIRECT_VALUE"
@@ -202,6 +331,7 @@ class PyUNOTestFunctions(unittest.TestCase):
         
         self.assertFalse(e == em)
         self.assertTrue(e != em)
+        self.assertTrue(em not in {e: 1})
         
         # ToDo illegal type name and value
         
@@ -228,6 +358,22 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertEqual(c, v)
         self.assertEqual(c, c)
         self.assertNotEqual(c, uno.Char("v"))
+        self.assertEqual(hash(c), hash(v))
+        self.assertRaises(AttributeError, setattr, c, "value", "v")
+    
+    def test_pickle_values(self):
+        import pickle, copy
+        values = (
+            uno.Enum("com.sun.star.awt.FontSlant", "ITALIC"),
+            uno.getTypeByName("com.sun.star.beans.PropertyValue"),
+            uno.Char("a"),
+        )
+        for v in values:
+            self.assertEqual(pickle.loads(pickle.dumps(v)), v)
+            self.assertEqual(copy.copy(v), v)
+        a = uno.Any("[]long", (1, 2))
+        b = pickle.loads(pickle.dumps(a))
+        self.assertEqual((b.type, b.value), (a.type, a.value))
     
     def test_ByteSequence(self):
         a = b"abcdef"
@@ -265,6 +411,57 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertTrue(isinstance(r, uno.UNOStruct))
         self.assertEqual(Rectangle.typeName, "com.sun.star.awt.Rectangle")
         self.assertEqual(Rectangle.__pyunostruct__, "com.sun.star.awt.Rectangle")
+        r.X = 10
+        r.Width = 2.0
+        self.assertEqual((r.X, r.Width), (10, 2))
+        self.assertEqual(r, Rectangle(10, 0, 2, 0))
+        self.assertNotEqual(r, Rectangle())
+        self.assertEqual(Rectangle(r), r)
+        self.assertRaises(AttributeError, setattr, r, "Foo", 1)
+        self.assertTrue("Height" in dir(r))
+        import copy
+        c = copy.copy(r)
+        c.Y = 5
+        self.assertEqual((r.Y, c.Y), (0, 5))
+        self.assertEqual(copy.deepcopy(r), r)
+    
+    def test_struct_hash(self):
+        from com.sun.star.table import CellAddress
+        from com.sun.star.beans import PropertyValue
+        a = CellAddress(0, 1, 2)
+        self.assertEqual(hash(a), hash(CellAddress(0, 1, 2)))
+        self.assertEqual(len(set([a, CellAddress(0, 1, 2), CellAddress(0, 2, 1)])), 2)
+        d = {a: "a"}
+        self.assertEqual(d[CellAddress(0, 1, 2)], "a")
+        p = PropertyValue("Name", 0, 1.0, uno.Enum("com.sun.star.beans.PropertyState", "DIRECT_VALUE"))
+        self.assertTrue(p in set([PropertyValue("Name", 0, 1.0, p.State)]))
+    
+    def test_struct_repr_limits(self):
+        from com.sun.star.beans import PropertyValue
+        r = repr(PropertyValue(Name="a", Value=tuple(range(1000))))
+        self.assertTrue(", ... }" in r)
+        # elements are rendered as hex values, only the first 100 of them
+        self.assertTrue("{ 0x63 }" in r)
+        self.assertFalse("{ 0x64 }" in r)
+        self.assertFalse("0x96" in r)
+        v = 1
+        for i in range(12):
+            v = (v,)
+        self.assertTrue("{...}" in repr(PropertyValue(Name="a", Value=v)))
+        r = repr(PropertyValue(Name="a", Value="x" * 100000))
+        self.assertTrue(r.endswith("..."))
+        self.assertTrue(len(r) <= 8192 + 3)
+    
+    def test_nested_struct(self):
+        from com.sun.star.drawing import HomogenMatrix3, HomogenMatrixLine3
+        m = HomogenMatrix3()
+        m.Line1.Column1 = 2.0
+        self.assertEqual(m.Line1.Column1, 0.0)
+        line = m.Line1
+        m.Line1 = HomogenMatrixLine3(1.0, 0.0, 0.0)
+        self.assertEqual(line.Column1, 0.0)
+        self.assertEqual(m.Line1.Column1, 1.0)
+        self.assertTrue(isinstance(line, HomogenMatrixLine3))
     
     def test_import_exception(self):
         from com.sun.star.uno import RuntimeException
@@ -274,6 +471,22 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertTrue(isinstance(e, Exception))
         self.assertEqual(RuntimeException.typeName, "com.sun.star.uno.RuntimeException")
         self.assertEqual(RuntimeException.__pyunostruct__, "com.sun.star.uno.RuntimeException")
+        e = RuntimeException("foo", None)
+        self.assertEqual(e.Message, "foo")
+        self.assertEqual(e.args, ("foo",))
+        self.assertTrue(e in set([e]))
+        self.assertEqual(hash(e), hash(RuntimeException("foo", None)))
+        self.assertTrue(RuntimeException("foo", None) in set([e]))
+    
+    def test_struct_member_descriptor(self):
+        from com.sun.star.awt import Rectangle
+        from com.sun.star.table import CellAddress
+        descr = Rectangle.__dict__["Height"]
+        a = CellAddress(0, 1, 2)
+        self.assertRaises(TypeError, descr.__get__, a, type(a))
+        self.assertRaises(TypeError, descr.__set__, a, 1)
+        self.assertEqual(a, CellAddress(0, 1, 2))
+        self.assertEqual(descr.__get__(Rectangle(1, 2, 3, 4), Rectangle), 4)
     
     def test_import_enum(self):
         from com.sun.star.awt.FontSlant import OBLIQUE
@@ -285,6 +498,8 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertEqual(BLACK, 200.0)
         import com.sun.star.awt.PosSize as PosSize
         self.assertEqual(PosSize.X, 1)
+        self.assertTrue("X" in PosSize.__dict__)
+        self.assertTrue("POSSIZE" in PosSize.__all__)
     
     def test_import_typeOf(self):
         from com.sun.star.container import typeOfXNameAccess
@@ -437,7 +652,17 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertEqual(border.Color, border2.Color)
     
     def test_exception(self):
-        pass
+        from com.sun.star.container import NoSuchElementException
+        doc = self.get_doc()
+        families = doc.getStyleFamilies()
+        try:
+            families.getByName("NoSuchFamily")
+            self.fail()
+        except NoSuchElementException as e:
+            self.assertEqual(e.args, (e.Message,))
+            self.assertEqual(str(e), e.Message)
+            e.args = ("foo",)
+            self.assertEqual(e.args, ("foo",))
     
     def test_sequence(self):
         doc = self.get_doc()
@@ -451,6 +676,40 @@ class PyUNOTestFunctions(unittest.TestCase):
         data = table.getDataArray()
         self.assertEqual(data, a)
         
+        old = uno.setLazySequences(True)
+        try:
+            data = table.getDataArray()
+            self.assertTrue(isinstance(data, uno.UNOSequence))
+            self.assertEqual(len(data), 2)
+            self.assertEqual(data[-1], (1, 2))
+            self.assertEqual(data, a)
+            self.assertEqual(hash(data), hash(a))
+            self.assertEqual(repr(data), repr(a))
+            self.assertTrue(data in set([a]))
+            self.assertTrue((1, 2) in data)
+            self.assertFalse((2, 1) in data)
+            self.assertEqual([tuple(row) for row in data], list(a))
+            self.assertTrue(data < a + ((3,),))
+            self.assertTrue(data != a[:1])
+            table.setDataArray(data)
+            self.assertEqual(table.getDataArray(), a)
+        finally:
+            uno.setLazySequences(old)
+        
+        table.setDataArray([["a", "b"], [3, 4]])
+        self.assertEqual(table.getDataArray(), (("a", "b"), (3, 4)))
+        class Hint(object):
+            def __iter__(self):
+                return iter([(5, 6), (7, 8)])
+            def __length_hint__(self):
+                return 2 ** 40
+        import collections.abc
+        collections.abc.Sequence.register(Hint)
+        table.setDataArray(Hint())
+        self.assertEqual(table.getDataArray(), ((5, 6), (7, 8)))
+        table.setDataArray(tuple(row) for row in a)
+        self.assertEqual(table.getDataArray(), a)
+        
         
         from com.sun.star.beans import PropertyValue
         arg1 = PropertyValue()
@@ -470,6 +729,54 @@ class PyUNOTestFunctions(unittest.TestCase):
         text.getEnd().insertDocumentFromURL("", (arg1, arg2))
         sequence.closeInput()
     
+    def test_named_values(self):
+        d = {"Hidden": True, "FilterName": "writer8"}
+        self.assertEqual(uno.propertiesToDict(d), d)
+        from com.sun.star.beans import PropertyValue
+        self.assertEqual(
+            uno.propertiesToDict((PropertyValue(Name="Hidden", Value=True),)),
+            {"Hidden": True})
+        doc = self.get_desktop().loadComponentFromURL(
+            "private:factory/swriter", "_blank", 0, {"Hidden": True})
+        self.assertTrue(uno.propertiesToDict(doc.getArgs())["Hidden"])
+        doc.close(True)
+        
+        # the parameter is a sequence of NamedValue
+        filters = self.create("com.sun.star.document.FilterFactory")
+        e = filters.createSubSetEnumerationByProperties({"Name": "writer8"})
+        self.assertTrue(e.hasMoreElements())
+        self.assertEqual(e.nextElement(), "writer8")
+        
+        import types
+        self.assertEqual(
+            uno.propertiesToDict(types.MappingProxyType(d)), d)
+        class Items(object):
+            def items(self):
+                return [("Hidden", True)]
+        from com.sun.star.uno import RuntimeException
+        self.assertRaises(RuntimeException, uno.propertiesToDict, Items())
+    
+    def test_call_frame_reuse(self):
+        # short calls share pooled parameter sequences, the values given to
+        # earlier calls must not change with later calls
+        values = self.create("com.sun.star.document.NamedPropertyValues")
+        for i in range(50):
+            values.insertByName("n%d" % i, i)
+            values.insertByName("s%d" % i, (i, str(i), float(i)))
+            self.assertTrue(values.hasByName("n%d" % i))
+        for i in range(0, 50, 2):
+            values.replaceByName("n%d" % i, -i)
+        for i in range(50):
+            self.assertEqual(values.getByName("n%d" % i), -i if i % 2 == 0 else i)
+            self.assertEqual(values.getByName("s%d" % i), (i, str(i), float(i)))
+        
+        doc = self.create_doc()
+        text = doc.getText()
+        for i in range(10):
+            text.insertString(text.getEnd(), str(i), False)
+        self.assertEqual(text.getString(), "0123456789")
+        doc.close(True)
+    
     def test_stream(self):
         path = "/home/asuka/foo.txt"
         b = b"test text"
@@ -482,6 +789,18 @@ class PyUNOTestFunctions(unittest.TestCase):
         v = d.value
         pipe.closeInput()
         self.assertEqual(v, b)
+        
+        pipe = self.create("com.sun.star.io.Pipe")
+        pipe.writeBytes(b)
+        pipe.writeBytes(bytearray(b"!"))
+        pipe.writeBytes(range(3))
+        from com.sun.star.uno import RuntimeException
+        self.assertRaises(RuntimeException, pipe.writeBytes, set([1, 2]))
+        pipe.flush()
+        pipe.closeOutput()
+        n, d = pipe.readBytes(None, 100)
+        pipe.closeInput()
+        self.assertEqual(d.value, b + b"!\x00\x01\x02")
     
     def test_interface(self):
         n = 0
@@ -497,6 +816,74 @@ class PyUNOTestFunctions(unittest.TestCase):
         self.assertEqual(n, 1)
         self.assertFalse(doc == desktop)
     
+    def test_binary_adapter_exception(self):
+        import unohelper
+        from com.sun.star.container import XNameAccess, NoSuchElementException
+        from com.sun.star.reflection import InvocationTargetException
+        class NameAccess(unohelper.Base, XNameAccess):
+            def getByName(self, name):
+                raise NoSuchElementException(name, self)
+            def getElementNames(self):
+                return ()
+            def hasByName(self, name):
+                return False
+            def getElementType(self):
+                return uno.getTypeByName("string")
+            def hasElements(self):
+                return False
+        # the office calls getByName through the binary adapter
+        inv = self.create("com.sun.star.script.Invocation").createInstanceWithArguments(
+            (NameAccess(),))
+        try:
+            inv.invoke("getByName", ("foo",), (), ())
+            self.fail()
+        except InvocationTargetException as e:
+            target = e.TargetException
+            while isinstance(target, InvocationTargetException):
+                target = target.TargetException
+            self.assertTrue(isinstance(target, NoSuchElementException))
+            self.assertEqual(target.Message, "foo")
+    
+    def test_adapter_class_change(self):
+        import unohelper
+        from com.sun.star.container import XNameAccess
+        class Base(unohelper.Base, XNameAccess):
+            def getByName(self, name):
+                return "base"
+            def getElementNames(self):
+                return ()
+            def hasByName(self, name):
+                return False
+            def getElementType(self):
+                return uno.getTypeByName("string")
+            def hasElements(self):
+                return False
+        class NameAccess(Base):
+            pass
+        obj = NameAccess()
+        inv = self.create("com.sun.star.script.Invocation").createInstanceWithArguments(
+            (obj,))
+        def get():
+            return inv.invoke("getByName", ("foo",), (), ())[0]
+        # the adapter caches the methods of the class, changes of the class
+        # or of its bases must be noticed
+        self.assertEqual(get(), "base")
+        self.assertEqual(get(), "base")
+        Base.getByName = lambda self, name: "changed base"
+        self.assertEqual(get(), "changed base")
+        NameAccess.getByName = lambda self, name: "changed class"
+        self.assertEqual(get(), "changed class")
+        obj.getByName = lambda name: "instance"
+        self.assertEqual(get(), "instance")
+        del obj.getByName
+        del NameAccess.getByName
+        self.assertEqual(get(), "changed base")
+        class Other(Base):
+            def getByName(self, name):
+                return "other"
+        obj.__class__ = Other
+        self.assertEqual(get(), "other")
+    
     def test_dialog(self):
         return # needs dialog and user interaction
         from com.sun.star.awt import XActionListener